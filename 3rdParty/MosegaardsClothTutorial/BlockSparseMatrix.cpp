@@ -0,0 +1,74 @@
+/**
+ * @file BlockSparseMatrix.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "BlockSparseMatrix.h"
+
+#include <algorithm>
+
+/* ******************************************************************************************** */
+void BlockSparseMatrix::buildPattern(size_t num_rows, const std::vector <std::pair <uint32_t, uint32_t> > &pairs) {
+
+	// Count the blocks of each row, with the diagonal, assuming no pair is repeated
+	std::vector <uint32_t> counts(num_rows, 1);
+	for(size_t k = 0; k < pairs.size(); k++) {
+		counts[pairs[k].first]++;
+		counts[pairs[k].second]++;
+	}
+	row_offsets.assign(num_rows + 1, 0);
+	for(size_t r = 0; r < num_rows; r++)
+		row_offsets[r + 1] = row_offsets[r] + counts[r];
+
+	// Fill in the columns, then sort and remove the repeated pairs from each row
+	columns.resize(row_offsets[num_rows]);
+	std::vector <uint32_t> fill(row_offsets.begin(), row_offsets.end() - 1);
+	for(size_t r = 0; r < num_rows; r++)
+		columns[fill[r]++] = r;
+	for(size_t k = 0; k < pairs.size(); k++) {
+		columns[fill[pairs[k].first]++] = pairs[k].second;
+		columns[fill[pairs[k].second]++] = pairs[k].first;
+	}
+	uint32_t out = 0;
+	diagonal.resize(num_rows);
+	for(size_t r = 0; r < num_rows; r++) {
+		std::vector <uint32_t>::iterator begin = columns.begin() + row_offsets[r], end = columns.begin() + row_offsets[r + 1];
+		std::sort(begin, end);
+		end = std::unique(begin, end);
+		row_offsets[r] = out;
+		for(std::vector <uint32_t>::iterator c = begin; c != end; c++, out++) {
+			columns[out] = *c;
+			if(*c == r) diagonal[r] = out;
+		}
+	}
+	row_offsets[num_rows] = out;
+	columns.resize(out);
+	blocks.resize(out);
+	setZero();
+}
+
+/* ******************************************************************************************** */
+uint32_t BlockSparseMatrix::find(uint32_t row, uint32_t column) const {
+	return std::lower_bound(columns.begin() + row_offsets[row], columns.begin() + row_offsets[row + 1], column)
+			- columns.begin();
+}
+
+/* ******************************************************************************************** */
+void BlockSparseMatrix::setZero() {
+	for(size_t b = 0; b < blocks.size(); b++)
+		blocks[b].setZero();
+}
+
+/* ******************************************************************************************** */
+void BlockSparseMatrix::multiply(const BlockVector &x, BlockVector &y) const {
+	const uint32_t *offsets = &row_offsets[0], *column = &columns[0];
+	const Eigen::Matrix3f *block = &blocks[0];
+	for(size_t r = 0; r < rows(); r++) {
+		Eigen::Vector3f sum = Eigen::Vector3f::Zero();
+		for(uint32_t b = offsets[r]; b < offsets[r + 1]; b++)
+			sum.noalias() += block[b] * x[column[b]];
+		y[r] = sum;
+	}
+}
@@ -0,0 +1,40 @@
+/**
+ * @file BlockSparseMatrix.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief A sparse matrix of 3x3 blocks in compressed rows, for the systems over the particles of a cloth
+ */
+
+#pragma once
+
+#include <Eigen/Core>
+#include <stdint.h>
+#include <vector>
+
+/* A vector with a 3D value per particle */
+typedef std::vector <Eigen::Vector3f> BlockVector;
+
+/* A square matrix with a row and a column of 3x3 blocks per particle. Only the blocks of the pattern are stored, row by
+ row: the blocks of row r are [row_offsets[r], row_offsets[r + 1]), with their columns sorted. The pattern is built
+ once and then the values are refilled as often as needed. */
+class BlockSparseMatrix {
+public:
+	std::vector <uint32_t> row_offsets;
+	std::vector <uint32_t> columns;  // the column of each block
+	std::vector <uint32_t> diagonal;  // the index of the diagonal block of each row
+	std::vector <Eigen::Matrix3f> blocks;
+
+	size_t rows() const { return diagonal.size(); }
+
+	/* Builds the pattern with the diagonal and the blocks (i, j) and (j, i) of each of the given pairs, and sets all
+	 the blocks to zero */
+	void buildPattern(size_t num_rows, const std::vector <std::pair <uint32_t, uint32_t> > &pairs);
+
+	/* The index of the block (row, column), which must be in the pattern */
+	uint32_t find(uint32_t row, uint32_t column) const;
+
+	void setZero();
+
+	/* y = A x, where x and y have an entry per row */
+	void multiply(const BlockVector &x, BlockVector &y) const;
+};
@@ -0,0 +1,558 @@
+/**
+ * @file Cloth.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "Cloth.h"
+
+#include "ClothState.h"
+#include "ConstraintHierarchy.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "TriangleMesh.h"
+
+#include <algorithm>
+
+/* ******************************************************************************************** */
+Cloth::Cloth(float width, float height, int num_particles_width, int num_particles_height,
+		std::shared_ptr <const Constraints> topology) :
+		num_particles_width(num_particles_width), num_particles_height(num_particles_height), width(width), height(height),
+		simd_level(detectSimdLevel()),
+		pool(NULL), deterministic(false), solver_mode(SOLVER_GAUSS_SEIDEL), relaxation(1.5f), stiffness(1.0f), damping((float) DAMPING),
+		max_iterations(CONSTRAINT_ITERATIONS), tolerance(0.0f), continuous_collision(false), has_last_ball(false),
+		grid_sleeping(false) {
+	particles.resize((size_t) num_particles_width * num_particles_height);  //I am essentially using these arrays with room for num_particles_width*num_particles_height particles
+
+	// creating particles in a grid of particles from (0,0,0) to (width,-height,0)
+	for(int x = 0; x < num_particles_width; x++) {
+		for(int y = 0; y < num_particles_height; y++) {
+//			Vec3 pos = Vec3(width * (x / (float) num_particles_width), -height * (y / (float) num_particles_height), 0);
+			Vec3 pos = Vec3(width * (x / (float) num_particles_width), 0.0, -height * (y / (float) num_particles_height));
+			particles.setPos(getParticle(x, y), pos);  // insert particle in column x at y'th row
+		}
+	}
+
+	// The constraints of a cloth with the same grid and size do not have to be built again
+	if(topology) constraints = topology;
+	else buildConstraints();
+	setUp();
+
+	// making the upper left most three and right most three particles unmovable
+	for(int i = 0; i < 3; i++) {
+//		particles.offsetPos(getParticle(0+i ,0), Vec3(0.5,0.0,0.0)); // moving the particle a bit towards the center, to make it hang more natural - because I like it ;)
+		particles.makeUnmovable(getParticle(0 + i, 0));
+		particles.makeUnmovable(getParticle(0 + i, num_particles_height - 1 - i));
+
+//		particles.offsetPos(getParticle(num_particles_width-1-i ,0), Vec3(-0.5,0.0,0.0)); // moving the particle a bit towards the center, to make it hang more natural - because I like it ;)
+		particles.makeUnmovable(getParticle(num_particles_width - 1 - i, num_particles_height - 1));
+		particles.makeUnmovable(getParticle(num_particles_width - 1 - i, 0));
+	}
+
+	// Try making all edges unmovable
+	for(int i = 0; i < num_particles_width; i++)
+		particles.makeUnmovable(getParticle(0 + i, 0));
+	for(int i = 0; i < num_particles_width; i++)
+		particles.makeUnmovable(getParticle(0 + i, num_particles_height - 1));
+	for(int i = 0; i < num_particles_height; i++)
+		particles.makeUnmovable(getParticle(0, i));
+	for(int i = 0; i < num_particles_height; i++)
+		particles.makeUnmovable(getParticle(num_particles_width - 1, i));
+}
+
+/* ******************************************************************************************** */
+Cloth::Cloth(const TriangleMesh &mesh, std::shared_ptr <const Constraints> topology) :
+		num_particles_width(mesh.vertices.size()), num_particles_height(1), width(0), height(0),
+		simd_level(detectSimdLevel()),
+		pool(NULL), deterministic(false), solver_mode(SOLVER_GAUSS_SEIDEL), relaxation(1.5f), stiffness(1.0f), damping((float) DAMPING),
+		max_iterations(CONSTRAINT_ITERATIONS), tolerance(0.0f), continuous_collision(false), has_last_ball(false),
+		grid_sleeping(false) {
+	particles.resize(mesh.vertices.size());
+	for(size_t i = 0; i < mesh.vertices.size(); i++)
+		particles.setPos(i, mesh.vertices[i]);
+	triangles = std::make_shared <const std::vector <uint32_t> >(mesh.triangles);
+
+	if(topology) constraints = topology;
+	else {
+		std::shared_ptr <Constraints> built = std::make_shared <Constraints>();
+		mesh.buildConstraints(*built);
+		constraints = built;
+	}
+	setUp();
+
+	// The edges of the patch are held, as those of the grid
+	std::vector <uint32_t> boundary = mesh.boundaryVertices();
+	for(size_t i = 0; i < boundary.size(); i++)
+		particles.makeUnmovable(boundary[i]);
+}
+
+/* ******************************************************************************************** */
+void Cloth::setUp() {
+	stats.iterations = 0;
+	stats.max_violation = 0.0f;
+
+	tactile.resize(num_particles_width, num_particles_height);
+
+	// A cell of the collision grid holds a few particles
+	grid.setCellSize(*std::max_element(constraints->rest_distance.begin(), constraints->rest_distance.end()));
+}
+
+/* ******************************************************************************************** */
+void Cloth::buildConstraints() {
+	constraints = std::make_shared <Constraints>();
+
+	// Connecting immediate neighbor particles with constraints (distance 1 and sqrt(2) in the grid)
+	for(int x = 0; x < num_particles_width; x++) {
+		for(int y = 0; y < num_particles_height; y++) {
+			if(x < num_particles_width - 1) makeConstraint(getParticle(x, y), getParticle(x + 1, y));
+			if(y < num_particles_height - 1) makeConstraint(getParticle(x, y), getParticle(x, y + 1));
+			if(x < num_particles_width - 1 && y < num_particles_height - 1) makeConstraint(getParticle(x, y),
+					getParticle(x + 1, y + 1));
+			if(x < num_particles_width - 1 && y < num_particles_height - 1) makeConstraint(getParticle(x + 1, y),
+					getParticle(x, y + 1));
+		}
+	}
+
+	// Connecting secondary neighbors with constraints (distance 2 and sqrt(4) in the grid)
+	for(int x = 0; x < num_particles_width; x++) {
+		for(int y = 0; y < num_particles_height; y++) {
+			if(x < num_particles_width - 2) makeConstraint(getParticle(x, y), getParticle(x + 2, y));
+			if(y < num_particles_height - 2) makeConstraint(getParticle(x, y), getParticle(x, y + 2));
+			if(x < num_particles_width - 2 && y < num_particles_height - 2) makeConstraint(getParticle(x, y),
+					getParticle(x + 2, y + 2));
+			if(x < num_particles_width - 2 && y < num_particles_height - 2) makeConstraint(getParticle(x + 2, y),
+					getParticle(x, y + 2));
+		}
+	}
+
+	// Group the constraints into batches of independent constraints for the vectorized kernels
+	mutableConstraints().buildBatches();
+}
+
+/* ******************************************************************************************** */
+Constraints& Cloth::mutableConstraints() {
+	if(constraints.use_count() > 1) constraints = std::make_shared <Constraints>(*constraints);  // copy on write
+	return const_cast <Constraints &>(*constraints);  // we made it, so it is not really const
+}
+
+/* ******************************************************************************************** */
+void Cloth::addWindForcesForTriangle(int p1, int p2, int p3, const Vec3 direction) {
+	Vec3 normal = calcTriangleNormal(p1, p2, p3);
+	Vec3 d = normal.normalized();
+	Vec3 force = normal * (d.dot(direction));
+	particles.addForce(p1, force);
+	particles.addForce(p2, force);
+	particles.addForce(p3, force);
+}
+
+/* ******************************************************************************************** */
+/* Adds the unit normal of the triangle p1, p2, p3 to the normals of its corners */
+static inline void addTriangleNormal(uint32_t p1, uint32_t p2, uint32_t p3, const float *x, const float *y,
+		const float *z, float *nx, float *ny, float *nz) {
+	float ux = x[p2] - x[p1], uy = y[p2] - y[p1], uz = z[p2] - z[p1];
+	float vx = x[p3] - x[p1], vy = y[p3] - y[p1], vz = z[p3] - z[p1];
+	float cx = uy * vz - uz * vy, cy = uz * vx - ux * vz, cz = ux * vy - uy * vx;
+	float scale = 1.0f / sqrtf(cx * cx + cy * cy + cz * cz);
+	cx *= scale;
+	cy *= scale;
+	cz *= scale;
+	nx[p1] += cx; ny[p1] += cy; nz[p1] += cz;
+	nx[p2] += cx; ny[p2] += cy; nz[p2] += cz;
+	nx[p3] += cx; ny[p3] += cy; nz[p3] += cz;
+}
+
+/* ******************************************************************************************** */
+void Cloth::computeNormals() {
+	CLOTH_PROFILE_SCOPE("computeNormals");
+
+	// reset normals (which where written to last frame)
+	particles.resetNormals();
+
+	// create smooth per particle normals by adding up all the (hard) triangle normals that each particle is part of.
+	// The quads are walked row by row, in the order of the particles in memory, and each triangle normal is
+	// normalized once for its three corners
+	const float *x = &particles.x[0], *y = &particles.y[0], *z = &particles.z[0];
+	float *nx = &particles.normal_x[0], *ny = &particles.normal_y[0], *nz = &particles.normal_z[0];
+	if(triangles) {
+		const std::vector <uint32_t> &corners = *triangles;
+		for(size_t t = 0; t + 2 < corners.size(); t += 3)
+			addTriangleNormal(corners[t], corners[t + 1], corners[t + 2], x, y, z, nx, ny, nz);
+		return;
+	}
+	const uint32_t w = num_particles_width;
+	for(uint32_t row = 0; row + 1 < (uint32_t) num_particles_height; row++) {
+		for(uint32_t p = row * w; p < row * w + w - 1; p++) {  // the particle at (x, y) of the quad
+			addTriangleNormal(p + 1, p, p + w, x, y, z, nx, ny, nz);
+			addTriangleNormal(p + w + 1, p + 1, p + w, x, y, z, nx, ny, nz);
+		}
+	}
+}
+
+/* ******************************************************************************************** */
+void Cloth::setThreadPool(ThreadPool *pool) {
+	this->pool = pool;
+
+	// One thread keeps the serial order, which walks the grid in memory order, unless the results have to match a pool
+	bool colored = deterministic || (pool != NULL && pool->size() > 1);
+	if(colored && !constraints->isColored()) mutableConstraints().buildColors();
+	else if(!colored && constraints->isColored()) mutableConstraints().buildBatches();
+}
+
+/* ******************************************************************************************** */
+void Cloth::setDeterministic(bool enabled) {
+	deterministic = enabled;
+	setThreadPool(pool);  // colors the constraints, or puts them back in the order of the pool
+}
+
+/* ******************************************************************************************** */
+uint64_t Cloth::stateHash() const {
+	uint64_t hash = 0xcbf29ce484222325ull;
+	const std::vector <float> *arrays[6] = {&particles.x, &particles.y, &particles.z, &particles.old_x, &particles.old_y,
+			&particles.old_z};
+	for(int a = 0; a < 6; a++) {
+		const unsigned char *bytes = (const unsigned char *) arrays[a]->data();
+		for(size_t i = 0; i < arrays[a]->size() * sizeof(float); i++)
+			hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+/* ******************************************************************************************** */
+void Cloth::setSolverMode(SolverMode mode) {
+	solver_mode = mode;
+	if(mode == SOLVER_JACOBI) {
+		if(!constraints->hasAdjacency()) mutableConstraints().buildAdjacency(particles.size());
+		correction_x.resize(constraints->size());
+		correction_y.resize(constraints->size());
+		correction_z.resize(constraints->size());
+	}
+}
+
+/* ******************************************************************************************** */
+void Cloth::setHierarchyLevels(int num_levels, int iterations) {
+	if(num_levels > 0 && !triangles)
+		hierarchy = std::make_shared <ConstraintHierarchy>(width, height, num_particles_width, num_particles_height,
+				num_levels, iterations);
+	else hierarchy.reset();
+}
+
+/* ******************************************************************************************** */
+int Cloth::getHierarchyLevels() const {
+	return hierarchy ? (int) hierarchy->numLevels() : 0;
+}
+
+/* ******************************************************************************************** */
+void Cloth::setSleeping(bool enabled, int tile_size, float threshold, int sleep_steps) {
+	if(sleep_tiles) sleep_tiles->wakeAll(particles);
+	if(enabled && !triangles) sleep_tiles = std::make_shared <SleepTiles>(*constraints, particles, num_particles_width, num_particles_height,
+			tile_size, threshold, sleep_steps);
+	else sleep_tiles.reset();
+	grid_sleeping = false;
+}
+
+/* ******************************************************************************************** */
+void Cloth::setSelfCollision(bool enabled, float thickness) {
+	if(!enabled) {
+		self_collision.reset();
+		return;
+	}
+
+	// The grid has the triangles it is drawn with, two per quad, in the order of the particles
+	std::shared_ptr <const std::vector <uint32_t> > corners = triangles;
+	if(!corners) {
+		std::shared_ptr <std::vector <uint32_t> > quads = std::make_shared <std::vector <uint32_t> >();
+		quads->reserve((size_t) 6 * (num_particles_width - 1) * (num_particles_height - 1));
+		for(int y = 0; y < num_particles_height - 1; y++) {
+			for(int x = 0; x < num_particles_width - 1; x++) {
+				uint32_t quad[6] = {(uint32_t) getParticle(x + 1, y), (uint32_t) getParticle(x, y), (uint32_t) getParticle(x, y + 1),
+						(uint32_t) getParticle(x + 1, y + 1), (uint32_t) getParticle(x + 1, y), (uint32_t) getParticle(x, y + 1)};
+				quads->insert(quads->end(), quad, quad + 6);
+			}
+		}
+		corners = quads;
+	}
+	self_collision = std::make_shared <SelfCollision>(*constraints, corners, thickness);
+}
+
+/* ******************************************************************************************** */
+void Cloth::runJob(const std::function <void(int, int)> &job) {
+	if(pool != NULL) pool->run(job);
+	else job(0, 1);
+}
+
+/* ******************************************************************************************** */
+float Cloth::shareViolation(int thread, int num_threads, int iteration, float violation, bool publish) {
+	const size_t stride = 16;  // a cache line per thread
+	float *slots = &violation_slots[(iteration & 1) * stride * num_threads];
+	if(publish) {
+		slots[thread * stride] = violation;
+		return violation;
+	}
+	float max_violation = 0.0f;
+	for(int t = 0; t < num_threads; t++)
+		max_violation = fmaxf(max_violation, slots[t * stride]);
+	return max_violation;
+}
+
+/* ******************************************************************************************** */
+void Cloth::satisfyConstraintsParallel() {
+	SpinBarrier barrier(pool != NULL ? pool->size() : 1);
+	violation_slots.resize(2 * 16 * (pool != NULL ? pool->size() : 1));
+	runJob([&](int thread, int num_threads) {
+		CLOTH_PROFILE_SCOPE("solverThread");
+		for(int i = 0; i < max_iterations; i++) {  // iterate over all constraints several times
+			float violation = 0.0f;
+			for(size_t c = 0; c < constraints->numColors(); c++) {
+
+				// Satisfy our share of the color, and wait for the others before moving to the next color
+				size_t begin = constraints->color_offsets[c], end = constraints->color_offsets[c + 1];
+				if(deterministic) {  // our share of the chunks, each on its own
+					size_t first = begin / DETERMINISTIC_CHUNK, last = (end + DETERMINISTIC_CHUNK - 1) / DETERMINISTIC_CHUNK;
+					size_t chunk_end = splitPoint(first, last, thread + 1, num_threads, 1);
+					for(size_t k = splitPoint(first, last, thread, num_threads, 1); k < chunk_end; k++)
+						violation = fmaxf(violation, satisfyConstraints(*constraints, std::max(begin, k * DETERMINISTIC_CHUNK),
+								std::min(end, (k + 1) * DETERMINISTIC_CHUNK), particles, stiffness, simd_level));
+				}
+				else violation = fmaxf(violation, satisfyConstraints(*constraints,
+						splitPoint(begin, end, thread, num_threads, CONSTRAINT_BATCH),
+						splitPoint(begin, end, thread + 1, num_threads, CONSTRAINT_BATCH), particles, stiffness, simd_level));
+				if(c + 1 == constraints->numColors()) shareViolation(thread, num_threads, i, violation, true);
+				barrier.wait();
+			}
+
+			// All the threads see the same violation and make the same decision
+			violation = shareViolation(thread, num_threads, i, violation, false);
+			if(thread == 0) {
+				stats.iterations = i + 1;
+				stats.max_violation = violation;
+			}
+			if(violation < tolerance) break;
+		}
+	});
+}
+
+/* ******************************************************************************************** */
+void Cloth::satisfyConstraintsJacobi() {
+	SpinBarrier barrier(pool != NULL ? pool->size() : 1);
+	violation_slots.resize(2 * 16 * (pool != NULL ? pool->size() : 1));
+	runJob([&](int thread, int num_threads) {
+		CLOTH_PROFILE_SCOPE("solverThread");
+		float *x = &particles.x[0], *y = &particles.y[0], *z = &particles.z[0];
+		const float *inv_mass = &particles.inv_mass[0];
+		const float *cx = &correction_x[0], *cy = &correction_y[0], *cz = &correction_z[0];
+		const uint32_t *offsets = &constraints->adjacency_offsets[0], *adjacency = &constraints->adjacency[0];
+
+		// Our constraints and particles
+		size_t c_begin = splitPoint(0, constraints->size(), thread, num_threads, CONSTRAINT_BATCH);
+		size_t c_end = splitPoint(0, constraints->size(), thread + 1, num_threads, CONSTRAINT_BATCH);
+		size_t p_begin = splitPoint(0, particles.size(), thread, num_threads, 16);
+		size_t p_end = splitPoint(0, particles.size(), thread + 1, num_threads, 16);
+
+		for(int i = 0; i < max_iterations; i++) {  // iterate over all constraints several times
+
+			// Compute the corrections from the positions, which nobody moves until the barrier
+			float violation = computeCorrections(*constraints, c_begin, c_end, particles, stiffness, &correction_x[0],
+					&correction_y[0], &correction_z[0], simd_level);
+			shareViolation(thread, num_threads, i, violation, true);
+			barrier.wait();
+			violation = shareViolation(thread, num_threads, i, violation, false);
+			if(thread == 0) {
+				stats.iterations = i + 1;
+				stats.max_violation = violation;
+			}
+
+			// Move each particle by the average of the corrections of its constraints, negated if it is p2
+			for(size_t p = p_begin; p < p_end; p++) {
+				uint32_t count = offsets[p + 1] - offsets[p];
+				if(count == 0) continue;
+				float dx = 0.0f, dy = 0.0f, dz = 0.0f;
+				for(uint32_t k = offsets[p]; k < offsets[p + 1]; k++) {
+					uint32_t c = adjacency[k] >> 1;
+					float sign = 1.0f - 2.0f * (float) (adjacency[k] & 1);
+					dx += sign * cx[c];
+					dy += sign * cy[c];
+					dz += sign * cz[c];
+				}
+				float scale = relaxation * inv_mass[p] / count;
+				x[p] += dx * scale;
+				y[p] += dy * scale;
+				z[p] += dz * scale;
+			}
+			barrier.wait();
+			if(violation < tolerance) break;
+		}
+	});
+}
+
+/* ******************************************************************************************** */
+SolverStats Cloth::satisfyConstraintsSerial() {
+	SolverStats stats = {0, 0.0f};
+	for(int i = 0; i < max_iterations; i++) {  // iterate over all constraints several times
+		stats.max_violation = satisfyConstraints(*constraints, 0, constraints->size(), particles, stiffness, simd_level);
+		stats.iterations = i + 1;
+		if(stats.max_violation < tolerance) break;  // stop once the cloth is satisfied well enough
+	}
+	return stats;
+}
+
+/* ******************************************************************************************** */
+void Cloth::getState(ClothState &state) const {
+	state.num_particles_width = num_particles_width;
+	state.num_particles_height = num_particles_height;
+	state.x = particles.x;
+	state.y = particles.y;
+	state.z = particles.z;
+	state.old_x = particles.old_x;
+	state.old_y = particles.old_y;
+	state.old_z = particles.old_z;
+	state.inv_mass = particles.inv_mass;
+	if(sleep_tiles)  // the frozen particles are only pinned for now
+		for(uint32_t i = 0; i < particles.size(); i++)
+			state.inv_mass[i] = sleep_tiles->getInvMass(i, particles);
+	state.pairs = constraints->pairs;
+	state.rest_distance = constraints->rest_distance;
+}
+
+/* ******************************************************************************************** */
+bool Cloth::setState(const ClothState &state) {
+	if(state.num_particles_width != num_particles_width || state.num_particles_height != num_particles_height
+			|| state.numParticles() != particles.size())
+		return false;
+	std::vector <float> rest;
+	if(!state.matchConstraints(*constraints, rest)) return false;
+	if(rest != constraints->rest_distance) mutableConstraints().rest_distance.swap(rest);
+
+	particles.x = state.x;
+	particles.y = state.y;
+	particles.z = state.z;
+	particles.old_x = state.old_x;
+	particles.old_y = state.old_y;
+	particles.old_z = state.old_z;
+	particles.inv_mass = state.inv_mass;
+	std::fill(particles.acc_x.begin(), particles.acc_x.end(), 0.0f);
+	std::fill(particles.acc_y.begin(), particles.acc_y.end(), 0.0f);
+	std::fill(particles.acc_z.begin(), particles.acc_z.end(), 0.0f);
+	has_last_ball = false;
+
+	// The tiles keep their own copies of the constraints, and start over awake
+	if(sleep_tiles) sleep_tiles = std::make_shared <SleepTiles>(*constraints, particles, num_particles_width,
+			num_particles_height, sleep_tiles->getTileSize(), sleep_tiles->getThreshold(), sleep_tiles->getSleepSteps());
+	grid_sleeping = false;  // the pinned particles may not be those of the grid
+	return true;
+}
+
+/* ******************************************************************************************** */
+SolverStats Cloth::satisfyConstraintsSleeping() {
+	SolverStats stats = {0, 0.0f};
+	for(int i = 0; i < max_iterations; i++) {
+		stats.max_violation = sleep_tiles->satisfyConstraints(particles, stiffness, simd_level);
+		stats.iterations = i + 1;
+		if(stats.max_violation < tolerance) break;
+	}
+	return stats;
+}
+
+/* ******************************************************************************************** */
+void Cloth::timeStep() {
+	CLOTH_PROFILE_SCOPE("timeStep");
+	stats.iterations = 0;
+	stats.max_violation = 0.0f;
+	bool sleeping = isSleepingStep();
+	if(sleeping) sleep_tiles->beginStep();
+	else if(sleep_tiles) sleep_tiles->wakeAll(particles);
+	if(hierarchy) {
+		CLOTH_PROFILE_SCOPE("hierarchy");
+		hierarchy->solve(particles, stiffness, simd_level);  // the long range errors first
+	}
+	{
+		CLOTH_PROFILE_SCOPE("constraints");
+		if(solver_mode == SOLVER_JACOBI)
+			satisfyConstraintsJacobi();
+		else if(constraints->isColored())
+			satisfyConstraintsParallel();
+		else if(sleeping)
+			stats = satisfyConstraintsSleeping();
+		else stats = satisfyConstraintsSerial();
+	}
+	CLOTH_PROFILE_COUNTER("sweeps", stats.iterations);
+	CLOTH_PROFILE_COUNTER("maxViolation", stats.max_violation);
+
+	CLOTH_PROFILE_SCOPE("integrate");
+	if(sleeping) sleep_tiles->endStep(particles, damping);  // the stepped tiles only
+	else particles.timeStep(damping);  // calculate the position of each particle at the next time step.
+}
+
+/* ******************************************************************************************** */
+void Cloth::addForce(const Vec3 direction) {
+	for(size_t i = 0; i < particles.size(); i++) {
+		particles.addForce(i, direction);  // add the forces to each particle
+	}
+}
+
+/* ******************************************************************************************** */
+void Cloth::windForce(const Vec3 direction) {
+	CLOTH_PROFILE_SCOPE("windForce");
+	if(triangles) {
+		const std::vector <uint32_t> &corners = *triangles;
+		for(size_t t = 0; t + 2 < corners.size(); t += 3)
+			addWindForcesForTriangle(corners[t], corners[t + 1], corners[t + 2], direction);
+		return;
+	}
+	for(int x = 0; x < num_particles_width - 1; x++) {
+		for(int y = 0; y < num_particles_height - 1; y++) {
+			addWindForcesForTriangle(getParticle(x + 1, y), getParticle(x, y), getParticle(x, y + 1), direction);
+			addWindForcesForTriangle(getParticle(x + 1, y + 1), getParticle(x + 1, y), getParticle(x, y + 1), direction);
+		}
+	}
+}
+
+/* ******************************************************************************************** */
+void Cloth::collide(const CollisionShape *shapes, size_t num_shapes) {
+	CLOTH_PROFILE_SCOPE("collide");
+	if(self_collision) {
+		CLOTH_PROFILE_SCOPE("selfCollision");
+		self_collision->solve(particles, pool);
+		CLOTH_PROFILE_COUNTER("selfContacts", self_collision->numContacts());
+	}
+
+	// The sleeping tiles did not move, but the grid has to know them from a full update since the tiles were made
+	bool sleeping = isSleepingStep();
+	if(sleeping && grid_sleeping) grid.update(particles, sleep_tiles->getActiveRanges());
+	else grid.update(particles, sleep_tiles.get());
+	grid_sleeping = sleeping;
+	tactile.beginFrame();
+	for(size_t s = 0; s < num_shapes; s++) {
+		const CollisionShape &shape = shapes[s];
+		Vec3 lo, hi;
+		shape.bounds(lo, hi);
+		if(continuous_collision) {
+
+			// Catch the particles that passed through the shape during the step
+			float motion = grid.getMaxMotion();
+			lo = lo - Vec3(motion, motion, motion);
+			hi = hi + Vec3(motion, motion, motion);
+			grid.query(lo, hi, [&](uint32_t i) {
+				Vec3 offset;
+				if(shape.sweptPenetration(particles.getOldPos(i), particles.getPos(i), offset)) resolveContact(i, offset);
+			});
+		}
+		else {
+			grid.query(lo, hi, [&](uint32_t i) {
+				Vec3 offset;
+				if(shape.penetration(particles.getPos(i), offset))  // if the particle is inside the shape
+					resolveContact(i, offset);  // project the particle to the surface of the shape
+			});
+		}
+	}
+	CLOTH_PROFILE_COUNTER("contacts", tactile.numContacts());
+}
+
+/* ******************************************************************************************** */
+void Cloth::ballCollision(const Vec3 center, const float radius) {
+	CLOTH_PROFILE_SCOPE("ballCollision");
+	CollisionShape ball = CollisionShape::sweptSphere(has_last_ball ? last_ball_center : center, center, radius);
+	last_ball_center = center;
+	has_last_ball = true;
+	collide(&ball, 1);
+}
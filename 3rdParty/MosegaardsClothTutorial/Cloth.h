@@ -7,238 +7,308 @@
 
 #pragma once
 
-#include "Constraint.h"
+#include "Collision.h"
+#include "ConstraintKernels.h"
+#include "SelfCollision.h"
+#include "SleepTiles.h"
+#include "TactileMap.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
 
-#include <GL/gl.h>
-#include <GL/glut.h>
+class ClothState;
+class ConstraintHierarchy;
+class ThreadPool;
+class TriangleMesh;
 
-#include <vector>
+/* What the constraint solver did in the last time step */
+struct SolverStats {
+	int iterations;  // the number of sweeps over the constraints
+	float max_violation;  // the largest violation in the last sweep, see Constraints::satisfyConstraint()
+};
+
+/* How the constraints are satisfied in each iteration */
+enum SolverMode {
+	SOLVER_GAUSS_SEIDEL = 0,  // each constraint moves the particles in place, seeing the corrections before it
+	SOLVER_JACOBI  // all corrections are computed from the same positions and then applied together, averaged
+};
 
+/* The physics core of the cloth. It has no OpenGL dependency so that it can be stepped on
+ render-less machines; drawing is done by the ClothRenderer in the viewer executable. */
 class Cloth {
 private:
 
 	int num_particles_width;  // number of particles in "width" direction
 	int num_particles_height;  // number of particles in "height" direction
 	// total number of particles is num_particles_width*num_particles_height
+	std::shared_ptr <const std::vector <uint32_t> > triangles;  // of a cloth made from a mesh, NULL for the grid
+	float width, height;  // the size of the cloth at rest
+
+	Particles particles;  // all particles that are part of this cloth
+	std::shared_ptr <const Constraints> constraints;  // alle constraints between particles as part of this cloth, maybe shared
+	SimdLevel simd_level;  // the instruction set used to satisfy the constraints
+	ThreadPool *pool;  // the threads that satisfy the constraints in parallel, not owned; NULL for serial
+	bool deterministic;  // the same floating point operations in the same order for any number of threads
+	SolverMode solver_mode;
+	float relaxation;  // the over-relaxation factor of the Jacobi solver
+	float stiffness;  // how much of the violation of a constraint is corrected at once, see Constraints::satisfyConstraint()
+	float damping;  // the fraction of the velocity lost in each time step
+	std::vector <float> correction_x, correction_y, correction_z;  // the correction of each constraint in a Jacobi iteration
+	int max_iterations;  // the most sweeps over the constraints in a time step
+	float tolerance;  // the sweeps stop once the largest violation is below this
+	SolverStats stats;  // of the last time step
+	std::shared_ptr <ConstraintHierarchy> hierarchy;  // the coarse lattices solved before the constraints, NULL for none
+	std::shared_ptr <SleepTiles> sleep_tiles;  // which parts of the grid are at rest, NULL if all are always stepped
+	std::vector <float> violation_slots;  // the violations of the threads, for the last two iterations
+	ParticleGrid grid;  // finds the particles near the collision shapes
+	std::shared_ptr <SelfCollision> self_collision;  // keeps the layers of a folded cloth apart, NULL if off
+	bool continuous_collision;  // sweep the spheres and the particle paths in collide()
+	Vec3 last_ball_center;  // where ballCollision() last had the ball, for sweeping it
+	bool has_last_ball;
+	bool grid_sleeping;  // whether the grid was last updated in a sleeping step, only then can it skip the frozen tiles
+	TactileMap tactile;  // what the particles felt in the last collide()
+
+	/* Moves the particle out of a shape by offset and records it in the tactile map */
+	void resolveContact(uint32_t i, const Vec3 &offset) {
+		if(sleep_tiles) sleep_tiles->wake(i, particles);  // before it is moved, it may be frozen
+		particles.offsetPos(i, offset);
+		float depth = offset.length();
+		tactile.record(i % num_particles_width, i / num_particles_width, depth,
+				depth / (particles.inv_mass[i] * (float) (TIME_STEPSIZE2)));
+	}
 
-	std::vector <Particle> particles;  // all particles that are part of this cloth
-	std::vector <Constraint> constraints;  // alle constraints between particles as part of this cloth
+	/* Publishes the violation of this thread in an iteration if publish is true, otherwise returns the largest
+	 violation of all the threads in it. There must be a barrier between the two calls. */
+	float shareViolation(int thread, int num_threads, int iteration, float violation, bool publish);
 
-	Particle* getParticle(int x, int y) {
-		return &particles[y * num_particles_width + x];
-	}
-	void makeConstraint(Particle *p1, Particle *p2) {
-		constraints.push_back(Constraint(p1, p2));
-	}
+	/* Runs job(thread, num_threads) on the threads of the pool, or on this thread if there is no pool */
+	void runJob(const std::function <void(int, int)> &job);
 
-	/* A private method used by drawShaded() and addWindForcesForTriangle() to retrieve the
-	 normal vector of the triangle defined by the position of the particles p1, p2, and p3.
-	 The magnitude of the normal vector is equal to the area of the parallelogram defined by p1, p2 and p3
-	 */
-	Vec3 calcTriangleNormal(Particle *p1, Particle *p2, Particle *p3) {
-		Vec3 pos1 = p1->getPos();
-		Vec3 pos2 = p2->getPos();
-		Vec3 pos3 = p3->getPos();
+	/* Runs the Gauss-Seidel constraint iterations of a time step color by color on the threads of the pool, or on this
+	 thread in the deterministic mode without a pool */
+	void satisfyConstraintsParallel();
 
-		Vec3 v1 = pos2 - pos1;
-		Vec3 v2 = pos3 - pos1;
+	/* Runs the Jacobi constraint iterations of a time step */
+	void satisfyConstraintsJacobi();
 
-		return v1.cross(v2);
+	/* Whether this time step skips the sleeping tiles, only the serial Gauss-Seidel solver does */
+	bool isSleepingStep() const {
+		return sleep_tiles && solver_mode == SOLVER_GAUSS_SEIDEL && !constraints->isColored();
 	}
 
-	/* A private method used by windForce() to calcualte the wind force for a single triangle
-	 defined by p1,p2,p3*/
-	void addWindForcesForTriangle(Particle *p1, Particle *p2, Particle *p3, const Vec3 direction) {
-		Vec3 normal = calcTriangleNormal(p1, p2, p3);
-		Vec3 d = normal.normalized();
-		Vec3 force = normal * (d.dot(direction));
-		p1->addForce(force);
-		p2->addForce(force);
-		p3->addForce(force);
-	}
+	/* Runs the Gauss-Seidel constraint iterations of a time step over the tiles that are awake or next to one */
+	SolverStats satisfyConstraintsSleeping();
 
-	/* A private method used by drawShaded(), that draws a single triangle p1,p2,p3 with a color*/
-	void drawTriangle(Particle *p1, Particle *p2, Particle *p3, const Vec3 color) {
-		glColor3fv((GLfloat*) &color);
+	/* Connects the particles of the grid and groups the constraints into batches */
+	void buildConstraints();
 
-		Vec3 n1 = p1->getNormal().normalized();
-		glNormal3f(n1.f[0], n1.f[1], n1.f[2]);
-		glVertex3fv((GLfloat *) &(p1->getPos()));
+	/* The rest of the constructors, once the particles and the constraints are made */
+	void setUp();
 
-		Vec3 n2 = p1->getNormal().normalized();
-		glNormal3f(n2.f[0], n2.f[1], n2.f[2]);
-		glVertex3fv((GLfloat *) &(p2->getPos()));
+	/* The constraints, copied first if other cloths share them */
+	Constraints& mutableConstraints();
 
-		Vec3 n3 = p1->getNormal().normalized();
-		glNormal3f(n3.f[0], n3.f[1], n3.f[2]);
-		glVertex3fv((GLfloat *) &(p3->getPos()));
+	void makeConstraint(int p1, int p2) {
+		mutableConstraints().add(particles, p1, p2);
 	}
 
-public:
+	/* A private method used by windForce() to calcualte the wind force for a single triangle
+	 defined by p1,p2,p3*/
+	void addWindForcesForTriangle(int p1, int p2, int p3, const Vec3 direction);
 
-	/* This is a important constructor for the entire system of particles and constraints*/
-	Cloth(float width, float height, int num_particles_width, int num_particles_height) :
-			num_particles_width(num_particles_width), num_particles_height(num_particles_height) {
-		particles.resize((size_t) num_particles_width * num_particles_height);  //I am essentially using this vector as an array with room for num_particles_width*num_particles_height particles
-
-		// creating particles in a grid of particles from (0,0,0) to (width,-height,0)
-		for(int x = 0; x < num_particles_width; x++) {
-			for(int y = 0; y < num_particles_height; y++) {
-//				Vec3 pos = Vec3(width * (x / (float) num_particles_width), -height * (y / (float) num_particles_height), 0);
-				Vec3 pos = Vec3(width * (x / (float) num_particles_width), 0.0, -height * (y / (float) num_particles_height));
-				particles[y * num_particles_width + x] = Particle(pos);  // insert particle in column x at y'th row
-			}
-		}
-
-		// Connecting immediate neighbor particles with constraints (distance 1 and sqrt(2) in the grid)
-		for(int x = 0; x < num_particles_width; x++) {
-			for(int y = 0; y < num_particles_height; y++) {
-				if(x < num_particles_width - 1) makeConstraint(getParticle(x, y), getParticle(x + 1, y));
-				if(y < num_particles_height - 1) makeConstraint(getParticle(x, y), getParticle(x, y + 1));
-				if(x < num_particles_width - 1 && y < num_particles_height - 1) makeConstraint(getParticle(x, y),
-						getParticle(x + 1, y + 1));
-				if(x < num_particles_width - 1 && y < num_particles_height - 1) makeConstraint(getParticle(x + 1, y),
-						getParticle(x, y + 1));
-			}
-		}
-
-		// Connecting secondary neighbors with constraints (distance 2 and sqrt(4) in the grid)
-		for(int x = 0; x < num_particles_width; x++) {
-			for(int y = 0; y < num_particles_height; y++) {
-				if(x < num_particles_width - 2) makeConstraint(getParticle(x, y), getParticle(x + 2, y));
-				if(y < num_particles_height - 2) makeConstraint(getParticle(x, y), getParticle(x, y + 2));
-				if(x < num_particles_width - 2 && y < num_particles_height - 2) makeConstraint(getParticle(x, y),
-						getParticle(x + 2, y + 2));
-				if(x < num_particles_width - 2 && y < num_particles_height - 2) makeConstraint(getParticle(x + 2, y),
-						getParticle(x, y + 2));
-			}
-		}
-
-		// making the upper left most three and right most three particles unmovable
-		for(int i = 0; i < 3; i++) {
-//			getParticle(0+i ,0)->offsetPos(Vec3(0.5,0.0,0.0)); // moving the particle a bit towards the center, to make it hang more natural - because I like it ;)
-			getParticle(0 + i, 0)->makeUnmovable();
-			getParticle(0 + i, num_particles_height - 1 - i)->makeUnmovable();
-
-//			getParticle(num_particles_width-1-i ,0)->offsetPos(Vec3(-0.5,0.0,0.0)); // moving the particle a bit towards the center, to make it hang more natural - because I like it ;)
-			getParticle(num_particles_width - 1 - i, num_particles_height - 1)->makeUnmovable();
-			getParticle(num_particles_width - 1 - i, 0)->makeUnmovable();
-		}
-
-		// Try making all edges unmovable
-		for(int i = 0; i < num_particles_width; i++)
-			getParticle(0 + i, 0)->makeUnmovable();
-		for(int i = 0; i < num_particles_width; i++)
-			getParticle(0 + i, num_particles_height - 1)->makeUnmovable();
-		for(int i = 0; i < num_particles_height; i++)
-			getParticle(0, i)->makeUnmovable();
-		for(int i = 0; i < num_particles_height; i++)
-			getParticle(num_particles_width - 1, i)->makeUnmovable();
+protected:
 
-	}
+	/* Runs the Gauss-Seidel constraint iterations of a time step on this thread, as many as getMaxIterations() unless
+	 the tolerance is met first. Overridden by FixedCloth with kernels specialized for its grid. */
+	virtual SolverStats satisfyConstraintsSerial();
 
-	/* drawing the cloth as a smooth shaded (and colored according to column) OpenGL triangular mesh
-	 Called from the display() method
-	 The cloth is seen as consisting of triangles for four particles in the grid as follows:
+public:
 
-	 (x,y)   *--* (x+1,y)
-	 | /|
-	 |/ |
-	 (x,y+1) *--* (x+1,y+1)
+	/* This is a important constructor for the entire system of particles and constraints. The constraints can be
+	 taken from the getTopology() of a cloth with the same size and number of particles, instead of being built again;
+	 they are then shared until one of the cloths reorders them (see setThreadPool() and setSolverMode()). */
+	Cloth(float width, float height, int num_particles_width, int num_particles_height,
+			std::shared_ptr <const Constraints> topology = std::shared_ptr <const Constraints>());
+
+	/* A cloth with a particle at each vertex of the mesh, the stretch and bending constraints of
+	 TriangleMesh::buildConstraints() (or the topology of a cloth made from the same mesh) and the vertices on its
+	 boundary pinned, as the edges of the grid are. The particles are in the order of the vertices, reorder the mesh
+	 with TriangleMesh::reorderMorton() first to keep the neighbors of a particle close in memory. It is treated as a
+	 grid of one row of particles: getParticle(i, 0) is the i'th vertex and the tactile map is one row of them. The
+	 coarse lattices and the sleeping tiles of the grid are not available. */
+	explicit Cloth(const TriangleMesh &mesh, std::shared_ptr <const Constraints> topology = std::shared_ptr <const Constraints>());
+	virtual ~Cloth() {}
+
+	int getNumParticlesWidth() const { return num_particles_width; }
+	int getNumParticlesHeight() const { return num_particles_height; }
+
+	/* the index of the particle in column x at the y'th row */
+	int getParticle(int x, int y) const {
+		return y * num_particles_width + x;
+	}
 
+	Particles& getParticles() { return particles; }
+	const Particles& getParticles() const { return particles; }
+	const Constraints& getConstraints() const { return *constraints; }
+	std::shared_ptr <const Constraints> getTopology() const { return constraints; }
+
+	/* The triangles of a cloth made from a mesh, three particles each, NULL for the grid */
+	std::shared_ptr <const std::vector <uint32_t> > getTriangles() const { return triangles; }
+
+	/* The constraints are projected with the best instruction set of the CPU by default, use SIMD_SCALAR for the reference kernel.
+	 Levels the CPU does not support fall back to the scalar kernel. */
+	void setSimdLevel(SimdLevel level) { simd_level = (level <= detectSimdLevel()) ? level : SIMD_SCALAR; }
+	SimdLevel getSimdLevel() const { return simd_level; }
+
+	/* With a pool of more than one thread the constraints are colored and each color is satisfied in
+	 parallel, with a barrier between the colors. The pool can be shared between cloths that are not stepped
+	 at the same time. NULL (or a pool of one thread) goes back to the serial solver, whose order of the constraints
+	 is not that of the colors: its results differ from those of any pool of 2 or more threads, which all agree with
+	 each other. setDeterministic() colors the constraints for one thread too, so that the results never depend on
+	 the number of threads. */
+	void setThreadPool(ThreadPool *pool);
+	ThreadPool* getThreadPool() const { return pool; }
+
+	/* In the deterministic mode a time step gives the same bits with any number of threads, so that runs can be replayed
+	 exactly: the constraints are colored even without a pool, and each color is split into chunks of
+	 DETERMINISTIC_CHUNK constraints at fixed boundaries that the threads share out, instead of one range per thread.
+	 The constraints of a color share no particles and the particles of the Jacobi solver gather their corrections in
+	 the order of their constraints, so neither depends on which thread does what. The forces, the collisions and the
+	 self collision are already computed in a fixed order. It costs the serial Gauss-Seidel solver its better order of
+	 the constraints, the sleeping tiles and the solver of FixedCloth. The vector kernels round differently on
+	 different CPUs (their reciprocal square roots are approximate), use SIMD_SCALAR to also replay across machines.
+	 Off by default. */
+	void setDeterministic(bool enabled);
+	bool getDeterministic() const { return deterministic; }
+
+	/* The constraints of a color in a chunk of the deterministic mode */
+	static const size_t DETERMINISTIC_CHUNK = 64 * CONSTRAINT_BATCH;
+
+	/* A 64 bit FNV-1a hash of the bytes of the positions and the previous positions of the particles, which are all a
+	 time step depends on besides the constraints. Two runs are the same as long as their hashes are, frame by frame. */
+	uint64_t stateHash() const;
+
+	/* The Jacobi solver computes the correction of every constraint from the positions at the start of an
+	 iteration, then moves each particle by relaxation times the average of the corrections of its constraints.
+	 Both phases are split over the threads without any contention: a thread writes only the corrections of its
+	 constraints, and then only the positions of its particles, gathering the corrections through the adjacency of
+	 the constraints. It converges slower than Gauss-Seidel per iteration but does not need the barriers between
+	 colors. The relaxation is usually between 1 and 2. */
+	void setSolverMode(SolverMode mode);
+	SolverMode getSolverMode() const { return solver_mode; }
+	void setRelaxation(float relaxation) { this->relaxation = relaxation; }
+	float getRelaxation() const { return relaxation; }
+
+	/* The stiffness of the constraints, in [0, 1]: the fraction of their violation that is corrected each time they
+	 are satisfied (1 by default). The damping is the fraction of the velocity lost in each time step (DAMPING by
+	 default). */
+	void setStiffness(float stiffness) { this->stiffness = stiffness; }
+	float getStiffness() const { return stiffness; }
+	void setDamping(float damping) { this->damping = damping; }
+	float getDamping() const { return damping; }
+
+	/* With num_levels > 0, each time step first satisfies coarser lattices of the grid (every 2nd, 4th, ... particle,
+	 up to num_levels of them) iterations times each and moves the particles in between with them, see
+	 ConstraintHierarchy. This spreads the corrections across large grids in a few sweeps so that they need far fewer
+	 iterations of the constraints to look as stiff; 0 turns it off (the default). The lattices are at the distances
+	 of the flat grid the cloth is made as, its rest shape, also after setState(). Grid only, ignored for a cloth made
+	 from a mesh. */
+	void setHierarchyLevels(int num_levels, int iterations = 4);
+	int getHierarchyLevels() const;
+
+	/* With sleeping on, the grid is split into tiles of tile_size x tile_size particles, and a tile whose particles have
+	 all moved less than threshold in each of sleep_steps time steps is no longer stepped until a collision or a moving
+	 neighbor disturbs it, see SleepTiles. Then the cost of a time step and of the collisions follows the part of the
+	 cloth that moves. Only the serial Gauss-Seidel solver skips the sleeping tiles, the others wake them all. It also
+	 takes the place of the solver of FixedCloth. Grid only, like the hierarchy. Off by default. */
+	void setSleeping(bool enabled, int tile_size = 8, float threshold = 1e-3f, int sleep_steps = 20);
+	bool getSleeping() const { return (bool) sleep_tiles; }
+	const SleepTiles* getSleepTiles() const { return sleep_tiles.get(); }
+
+	/* The solver sweeps the constraints at most max_iterations times (CONSTRAINT_ITERATIONS by default) and stops
+	 early once the largest violation in a sweep is below the tolerance (0 by default, so it never stops early).
+	 The violation of a constraint is |1 - rest_distance / current_distance|. */
+	void setMaxIterations(int max_iterations) { this->max_iterations = max_iterations; }
+	int getMaxIterations() const { return max_iterations; }
+	void setTolerance(float tolerance) { this->tolerance = tolerance; }
+	float getTolerance() const { return tolerance; }
+	const SolverStats& getSolverStats() const { return stats; }
+
+	/* Copies the positions, previous positions, inverse masses and rest distances into state, see ClothState */
+	void getState(ClothState &state) const;
+
+	/* Puts the cloth in the state of a cloth with the same grid, without building the constraints again: the rest
+	 distances are only copied if they differ, so cloths that share their constraints and are restored from the same
+	 state keep sharing them. The forces, the sleeping tiles and the last ball of the continuous collisions are reset.
+	 Returns false, leaving the cloth as it was, if the state is of another grid or constraints. */
+	virtual bool setState(const ClothState &state);
+
+	/* A method used by computeNormals() and addWindForcesForTriangle() to retrieve the
+	 normal vector of the triangle defined by the position of the particles p1, p2, and p3.
+	 The magnitude of the normal vector is equal to the area of the parallelogram defined by p1, p2 and p3
 	 */
-	void drawShaded() {
-		// reset normals (which where written to last frame)
-		std::vector <Particle>::iterator particle;
-		for(particle = particles.begin(); particle != particles.end(); particle++) {
-			(*particle).resetNormal();
-		}
-
-		//create smooth per particle normals by adding up all the (hard) triangle normals that each particle is part of
-		for(int x = 0; x < num_particles_width - 1; x++) {
-			for(int y = 0; y < num_particles_height - 1; y++) {
-				Vec3 normal = calcTriangleNormal(getParticle(x + 1, y), getParticle(x, y), getParticle(x, y + 1));
-				getParticle(x + 1, y)->addToNormal(normal);
-				getParticle(x, y)->addToNormal(normal);
-				getParticle(x, y + 1)->addToNormal(normal);
-
-				normal = calcTriangleNormal(getParticle(x + 1, y + 1), getParticle(x + 1, y), getParticle(x, y + 1));
-				getParticle(x + 1, y + 1)->addToNormal(normal);
-				getParticle(x + 1, y)->addToNormal(normal);
-				getParticle(x, y + 1)->addToNormal(normal);
-			}
-		}
-
-		glBegin(GL_TRIANGLES);
-		for(int x = 0; x < num_particles_width - 1; x++) {
-			for(int y = 0; y < num_particles_height - 1; y++) {
-				Vec3 color(0, 0, 0);
-				if(x % 2)  // red and white color is interleaved according to which column number
-				color = Vec3(0.6f, 0.2f, 0.2f);
-				else color = Vec3(1.0f, 1.0f, 1.0f);
-
-				drawTriangle(getParticle(x + 1, y), getParticle(x, y), getParticle(x, y + 1), color);
-				drawTriangle(getParticle(x + 1, y + 1), getParticle(x + 1, y), getParticle(x, y + 1), color);
-			}
-		}
-		glEnd();
+	Vec3 calcTriangleNormal(int p1, int p2, int p3) const {
+		Vec3 pos1 = particles.getPos(p1);
+		Vec3 pos2 = particles.getPos(p2);
+		Vec3 pos3 = particles.getPos(p3);
+
+		Vec3 v1 = pos2 - pos1;
+		Vec3 v2 = pos3 - pos1;
+
+		return v1.cross(v2);
 	}
 
+	/* create smooth per particle normals by adding up all the (hard) triangle normals that each particle is part of.
+	 Called by the renderer before drawing the cloth */
+	void computeNormals();
+
 	/* this is an important methods where the time is progressed one time step for the entire cloth.
-	 This includes calling satisfyConstraint() for every constraint, and calling timeStep() for all particles
+	 This includes calling satisfyConstraint() for every constraint, and calling timeStep() for the particles
 	 */
-	void timeStep() {
-		std::vector <Constraint>::iterator constraint;
-		for(int i = 0; i < CONSTRAINT_ITERATIONS; i++)  // iterate over all constraints several times
-				{
-			for(constraint = constraints.begin(); constraint != constraints.end(); constraint++) {
-				(*constraint).satisfyConstraint();  // satisfy constraint.
-			}
-		}
-
-		std::vector <Particle>::iterator particle;
-		for(particle = particles.begin(); particle != particles.end(); particle++) {
-			(*particle).timeStep();  // calculate the position of each particle at the next time step.
-		}
-	}
+	void timeStep();
 
 	/* used to add gravity (or any other arbitrary vector) to all particles*/
-	void addForce(const Vec3 direction) {
-		std::vector <Particle>::iterator particle;
-		for(particle = particles.begin(); particle != particles.end(); particle++) {
-			(*particle).addForce(direction);  // add the forces to each particle
-		}
-
-	}
+	void addForce(const Vec3 direction);
 
 	/* used to add wind forces to all particles, is added for each triangle since the final force is proportional to the triangle area as seen from the wind direction*/
-	void windForce(const Vec3 direction) {
-		for(int x = 0; x < num_particles_width - 1; x++) {
-			for(int y = 0; y < num_particles_height - 1; y++) {
-				addWindForcesForTriangle(getParticle(x + 1, y), getParticle(x, y), getParticle(x, y + 1), direction);
-				addWindForcesForTriangle(getParticle(x + 1, y + 1), getParticle(x + 1, y), getParticle(x, y + 1), direction);
-			}
-		}
-	}
+	void windForce(const Vec3 direction);
 
-	/* used to detect and resolve the collision of the cloth with the ball.
-	 This is based on a very simples scheme where the position of each particle is simply compared to the sphere and corrected.
-	 This also means that the sphere can "slip through" if the ball is small enough compared to the distance in the grid bewteen particles
+	/* used to detect and resolve the collision of the cloth with a set of rigid shapes.
+	 The grid over the particles is brought up to date first and each shape is only compared to the particles in the
+	 cells its bounding box overlaps. The particles inside a shape are simply moved to the closest point on its surface.
+	 This also means that a shape can "slip through" if it is small enough compared to the distance in the grid bewteen particles
+	 With self collision on, the cloth is pushed apart from itself before the shapes, so that the shapes have the last word.
 	 */
-	void ballCollision(const Vec3 center, const float radius) {
-		std::vector <Particle>::iterator particle;
-		for(particle = particles.begin(); particle != particles.end(); particle++) {
-			Vec3 v = (*particle).getPos() - center;
-			float l = v.length();
-			if(v.length() < radius)  // if the particle is inside the ball
-					{
-				(*particle).offsetPos(v.normalized() * (radius - l));  // project the particle to the surface of the ball
-			}
-		}
-	}
-
-	void doFrame() {
-
-	}
+	void collide(const CollisionShape *shapes, size_t num_shapes);
+	void collide(const std::vector <CollisionShape> &shapes) { collide(shapes.empty() ? NULL : &shapes[0], shapes.size()); }
+
+	/* The tactile image of the last collide(): a num_particles_width x num_particles_height image with the penetration,
+	 normal force and contact flag of each particle. Its views point into a buffer that is reused every frame. */
+	const TactileMap& getTactileMap() const { return tactile; }
+	TactileView getTactileView(TactileMap::Channel channel) const { return tactile.view(channel); }
+
+	/* With continuous collision detection, collide() sweeps the spheres from their old_center to their center and
+	 the particles from their old_pos to their pos, and resolves each particle at its earliest time of impact (see
+	 CollisionShape::sweptPenetration()). This stops fast probes from tunneling through the cloth without shrinking the
+	 time step. Off by default. */
+	void setContinuousCollision(bool enabled) { continuous_collision = enabled; }
+	bool getContinuousCollision() const { return continuous_collision; }
+
+	/* used to detect and resolve the collision of the cloth with the ball, see collide(). With continuous collision
+	 the ball is swept from where it was in the previous call */
+	void ballCollision(const Vec3 center, const float radius);
+
+	/* With self collision on, collide() first pushes apart the particles closer than thickness to each other or to a
+	 triangle of the cloth, so that the layers of a fold do not pass through each other, see SelfCollision. A thickness
+	 of 0 picks half of the shortest rest distance of the constraints. The contacts are found on the thread pool if there
+	 is one. Off by default. */
+	void setSelfCollision(bool enabled, float thickness = 0.0f);
+	bool getSelfCollision() const { return (bool) self_collision; }
+	const SelfCollision* getSelfCollider() const { return self_collision.get(); }
+
+	/* The edge length of the cells of the collision grid, the longest rest distance of the constraints by default */
+	void setCollisionCellSize(float cell_size) { grid.setCellSize(cell_size); }
+	float getCollisionCellSize() const { return grid.getCellSize(); }
 };
 
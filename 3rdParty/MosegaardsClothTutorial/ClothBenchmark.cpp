@@ -0,0 +1,349 @@
+/**
+ * @file ClothBenchmark.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief Times the parts of the physics core over a range of grids and thread counts, in the manner of Google
+ * Benchmark: each benchmark is run for enough iterations to last a minimum time, the timings are written as JSON,
+ * and a stored run can be given as the baseline to flag the benchmarks that got slower
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+
+#include "Cloth.h"
+#include "ThreadPool.h"
+
+/* What a benchmark measured, per iteration */
+struct BenchmarkResult {
+	std::string name;
+	long iterations;  // in each repetition
+	double real_time;  // the median wall time of an iteration over the repetitions, in ns
+	double cpu_time;  // the median process time of an iteration, in ns, summed over the threads
+	double items_per_second;  // constraints, particles or triangles handled, from the real time
+};
+
+/* How the benchmarks are run */
+struct BenchmarkOptions {
+	double min_time;  // seconds an iteration count has to last before it is measured
+	int repetitions;  // the measurements of a benchmark, the median is reported
+	const char *filter;  // only the benchmarks whose name contains this, NULL for all
+};
+
+/* ******************************************************************************************** */
+void usage(const char *name) {
+	printf("Usage: %s [options]\n", name);
+	printf("  -g <sizes>        comma separated particles per side of the square grids (default 17,32,64,128,256,512)\n");
+	printf("  -t <threads>      comma separated threads for the time step, 0 for all cores (default 1,0)\n");
+	printf("  -m <seconds>      minimum time of a measurement (default 0.2)\n");
+	printf("  -r <repetitions>  measurements of each benchmark, the median is reported (default 3)\n");
+	printf("  -f <filter>       only run the benchmarks whose name contains this\n");
+	printf("  -o <file>         write the results as JSON to the file\n");
+	printf("  -c <baseline>     compare with the JSON of an earlier run and flag the slower benchmarks\n");
+	printf("  -T <percent>      slow down of the real time above which a benchmark has regressed (default 10)\n");
+}
+
+/* ******************************************************************************************** */
+std::vector <int> parseList(const char *text) {
+	std::vector <int> values;
+	for(const char *c = text; *c != '\0'; ) {
+		char *end;
+		values.push_back((int) strtol(c, &end, 10));
+		if(end == c) return std::vector <int>();
+		c = (*end == ',') ? end + 1 : end;
+	}
+	return values;
+}
+
+/* ******************************************************************************************** */
+/* Runs body(iterations) and returns its wall time, with its process time in cpu_time, both in seconds */
+double measure(const std::function <void(long)> &body, long iterations, double &cpu_time) {
+	std::clock_t cpu_start = std::clock();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	body(iterations);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	cpu_time = (std::clock() - cpu_start) / (double) CLOCKS_PER_SEC;
+	return elapsed.count();
+}
+
+/* ******************************************************************************************** */
+/* Grows the number of iterations until they last options.min_time, then measures them options.repetitions times.
+ body(n) runs n iterations, each of which handles items things. */
+BenchmarkResult runBenchmark(const std::string &name, double items, const std::function <void(long)> &body,
+		const BenchmarkOptions &options) {
+
+	// Each guess aims a little past the minimum time, but grows the iterations at most tenfold
+	long iterations = 1;
+	double cpu_time;
+	for(double time = measure(body, iterations, cpu_time); time < options.min_time && iterations < 1000000000L; ) {
+		double growth = (time > 0.0) ? 1.4 * options.min_time / time : 10.0;
+		iterations = (long) ceil(iterations * std::max(std::min(growth, 10.0), 2.0));
+		time = measure(body, iterations, cpu_time);
+	}
+
+	std::vector <double> real_times, cpu_times;
+	for(int r = 0; r < options.repetitions; r++) {
+		real_times.push_back(measure(body, iterations, cpu_time) / iterations * 1e9);
+		cpu_times.push_back(cpu_time / iterations * 1e9);
+	}
+	std::sort(real_times.begin(), real_times.end());
+	std::sort(cpu_times.begin(), cpu_times.end());
+
+	BenchmarkResult result;
+	result.name = name;
+	result.iterations = iterations;
+	result.real_time = real_times[real_times.size() / 2];
+	result.cpu_time = cpu_times[cpu_times.size() / 2];
+	result.items_per_second = items / result.real_time * 1e9;
+	printf("%-48s %14.0f ns %14.0f ns %10ld %12.4g items/s\n", name.c_str(), result.real_time, result.cpu_time,
+			iterations, result.items_per_second);
+	fflush(stdout);
+	return result;
+}
+
+/* ******************************************************************************************** */
+/* Drapes the cloth over a ball from below for a few frames, so that the benchmarks start from a deformed cloth */
+void settle(Cloth &cloth, const Vec3 &ball_center, float ball_radius) {
+	for(int i = 0; i < 10; i++) {
+		cloth.addForce(Vec3(0.0, -0.2, 0.0) * TIME_STEPSIZE2);
+		cloth.timeStep();
+		cloth.ballCollision(ball_center, ball_radius);
+	}
+}
+
+/* ******************************************************************************************** */
+/* Writes the results in the JSON layout of Google Benchmark, so that its tools can read them as well */
+bool writeResults(const char *path, const std::vector <BenchmarkResult> &results, const BenchmarkOptions &options) {
+	FILE *file = fopen(path, "w");
+	if(file == NULL) return false;
+	char date[64];
+	std::time_t now = std::time(NULL);
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+	fprintf(file, "{\n  \"context\": {\n");
+	fprintf(file, "    \"date\": \"%s\",\n", date);
+	fprintf(file, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+	fprintf(file, "    \"simd_level\": \"%s\",\n", simdLevelName(detectSimdLevel()));
+	fprintf(file, "    \"min_time\": %g,\n", options.min_time);
+	fprintf(file, "    \"repetitions\": %d\n", options.repetitions);
+	fprintf(file, "  },\n  \"benchmarks\": [\n");
+	for(size_t i = 0; i < results.size(); i++) {
+		const BenchmarkResult &result = results[i];
+		fprintf(file, "    {\n      \"name\": \"%s\",\n      \"iterations\": %ld,\n      \"real_time\": %.3f,\n"
+				"      \"cpu_time\": %.3f,\n      \"time_unit\": \"ns\",\n      \"items_per_second\": %.6g\n    }%s\n",
+				result.name.c_str(), result.iterations, result.real_time, result.cpu_time, result.items_per_second,
+				(i + 1 < results.size()) ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+	return fclose(file) == 0;
+}
+
+/* ******************************************************************************************** */
+/* Reads the real time of each benchmark from a file written by writeResults() or by Google Benchmark. This is not a
+ JSON parser: it pairs each "name" with the "real_time" that follows it, which is all the two layouts need. */
+bool readBaseline(const char *path, std::map <std::string, double> &real_times) {
+	FILE *file = fopen(path, "r");
+	if(file == NULL) return false;
+	std::string text;
+	char buffer[4096];
+	for(size_t read; (read = fread(buffer, 1, sizeof(buffer), file)) > 0; )
+		text.append(buffer, read);
+	fclose(file);
+
+	for(size_t at = text.find("\"name\":"); at != std::string::npos; at = text.find("\"name\":", at)) {
+		size_t begin = text.find('"', at + 7);
+		size_t end = (begin != std::string::npos) ? text.find('"', begin + 1) : std::string::npos;
+		size_t time = (end != std::string::npos) ? text.find("\"real_time\":", end) : std::string::npos;
+		if(time == std::string::npos) break;
+		real_times[text.substr(begin + 1, end - begin - 1)] = strtod(text.c_str() + time + 12, NULL);
+		at = end;
+	}
+	return !real_times.empty();
+}
+
+/* ******************************************************************************************** */
+/* Prints the change of the real time of every benchmark that is in the baseline and returns the number of them
+ that got slower by more than threshold (a fraction) */
+int compareResults(const std::vector <BenchmarkResult> &results, const std::map <std::string, double> &baseline,
+		double threshold) {
+	int regressions = 0;
+	printf("\n%-48s %14s %14s %9s\n", "Comparison", "Baseline", "Now", "Change");
+	for(size_t i = 0; i < results.size(); i++) {
+		std::map <std::string, double>::const_iterator base = baseline.find(results[i].name);
+		if(base == baseline.end() || base->second <= 0.0) continue;
+		double change = results[i].real_time / base->second - 1.0;
+		const char *flag = "";
+		if(change > threshold) {
+			flag = "  REGRESSION";
+			regressions++;
+		}
+		else if(change < -threshold) flag = "  improved";
+		printf("%-48s %11.0f ns %11.0f ns %+8.1f%%%s\n", results[i].name.c_str(), base->second, results[i].real_time,
+				100.0 * change, flag);
+	}
+	printf("%d regression%s above %.1f%%\n", regressions, (regressions == 1) ? "" : "s", 100.0 * threshold);
+	return regressions;
+}
+
+/* ******************************************************************************************** */
+int main(int argc, char** argv) {
+
+	// Read the options
+	std::vector <int> sizes, threads;
+	sizes.push_back(17);  // the dim of the MATLAB sensor model
+	for(int size = 32; size <= 512; size *= 2)
+		sizes.push_back(size);
+	threads.push_back(1);
+	threads.push_back(0);
+	BenchmarkOptions options = {0.2, 3, NULL};
+	const char *output_path = NULL, *baseline_path = NULL;
+	double threshold = 10.0;
+	for(int i = 1; i < argc; i++) {
+		if(!strcmp(argv[i], "-g") && i + 1 < argc) sizes = parseList(argv[++i]);
+		else if(!strcmp(argv[i], "-t") && i + 1 < argc) threads = parseList(argv[++i]);
+		else if(!strcmp(argv[i], "-m") && i + 1 < argc) options.min_time = atof(argv[++i]);
+		else if(!strcmp(argv[i], "-r") && i + 1 < argc) options.repetitions = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-f") && i + 1 < argc) options.filter = argv[++i];
+		else if(!strcmp(argv[i], "-o") && i + 1 < argc) output_path = argv[++i];
+		else if(!strcmp(argv[i], "-c") && i + 1 < argc) baseline_path = argv[++i];
+		else if(!strcmp(argv[i], "-T") && i + 1 < argc) threshold = atof(argv[++i]);
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if(sizes.empty() || threads.empty() || options.min_time <= 0.0 || options.repetitions < 1
+			|| *std::min_element(sizes.begin(), sizes.end()) < 3) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	// Read the baseline first, so that a wrong path does not cost a whole run
+	std::map <std::string, double> baseline;
+	if(baseline_path != NULL && !readBaseline(baseline_path, baseline)) {
+		fprintf(stderr, "Could not read any benchmarks from %s\n", baseline_path);
+		return 1;
+	}
+
+	// The pools are made once, 0 threads being all the cores, and skipped if two counts come to the same pool
+	std::vector <std::unique_ptr <ThreadPool> > pools;
+	for(size_t t = 0; t < threads.size(); t++) {
+		std::unique_ptr <ThreadPool> pool(new ThreadPool(threads[t]));
+		bool seen = false;
+		for(size_t k = 0; k < pools.size(); k++)
+			seen = seen || (pools[k]->size() == pool->size());
+		if(!seen) pools.push_back(std::move(pool));
+	}
+
+	printf("%-48s %17s %17s %10s\n", "Benchmark", "Time", "CPU", "Iterations");
+	std::vector <BenchmarkResult> results;
+	std::function <bool(const std::string &)> wanted = [&](const std::string &name) {
+		return options.filter == NULL || name.find(options.filter) != std::string::npos;
+	};
+	const float width = 14.0f, height = 10.0f;
+	const Vec3 ball_center(width / 2, 0.2, -height / 2);
+	const float ball_radius = 1.0f;
+	for(size_t s = 0; s < sizes.size(); s++) {
+		const int size = sizes[s];
+		const std::string grid = std::to_string(size) + "x" + std::to_string(size);
+		const double num_particles = (double) size * size;
+		const double num_triangles = 2.0 * (size - 1) * (size - 1);
+
+		// The projection of all the constraints once, with each kernel the CPU has
+		for(int level = SIMD_SCALAR; level <= detectSimdLevel(); level++) {
+			std::string name = "satisfyConstraints/" + grid + "/" + simdLevelName((SimdLevel) level);
+			if(!wanted(name)) continue;
+			Cloth cloth(width, height, size, size);
+			settle(cloth, ball_center, ball_radius);
+			const Constraints &constraints = cloth.getConstraints();
+			Particles &particles = cloth.getParticles();
+			results.push_back(runBenchmark(name, (double) constraints.size(), [&](long iterations) {
+				for(long i = 0; i < iterations; i++)
+					satisfyConstraints(constraints, 0, constraints.size(), particles, 1.0f, (SimdLevel) level);
+			}, options));
+		}
+
+		// A whole time step, the constraint iterations and the integration, on each pool
+		for(size_t p = 0; p < pools.size(); p++) {
+			std::string name = "timeStep/" + grid + "/threads:" + std::to_string(pools[p]->size());
+			if(!wanted(name)) continue;
+			Cloth cloth(width, height, size, size);
+			if(pools[p]->size() > 1) cloth.setThreadPool(pools[p].get());
+			settle(cloth, ball_center, ball_radius);
+			results.push_back(runBenchmark(name, num_particles, [&](long iterations) {
+				for(long i = 0; i < iterations; i++)
+					cloth.timeStep();
+			}, options));
+		}
+
+		// The same in the deterministic mode, whose colored constraints are also used on one thread, in fixed chunks
+		for(size_t p = 0; p < pools.size(); p++) {
+			std::string name = "timeStep/" + grid + "/deterministic/threads:" + std::to_string(pools[p]->size());
+			if(!wanted(name)) continue;
+			Cloth cloth(width, height, size, size);
+			if(pools[p]->size() > 1) cloth.setThreadPool(pools[p].get());
+			cloth.setDeterministic(true);
+			settle(cloth, ball_center, ball_radius);
+			results.push_back(runBenchmark(name, num_particles, [&](long iterations) {
+				for(long i = 0; i < iterations; i++)
+					cloth.timeStep();
+			}, options));
+		}
+
+		// The hash of the state that deterministic runs are compared by every frame
+		std::string name = "stateHash/" + grid;
+		if(wanted(name)) {
+			Cloth cloth(width, height, size, size);
+			settle(cloth, ball_center, ball_radius);
+			results.push_back(runBenchmark(name, num_particles, [&](long iterations) {
+				for(long i = 0; i < iterations; i++)
+					cloth.stateHash();
+			}, options));
+		}
+
+		// The forces, the collision and the normals of the drawing, which are serial
+		name = "windForce/" + grid;
+		if(wanted(name)) {
+			Cloth cloth(width, height, size, size);
+			settle(cloth, ball_center, ball_radius);
+			results.push_back(runBenchmark(name, num_triangles, [&](long iterations) {
+				for(long i = 0; i < iterations; i++)
+					cloth.windForce(Vec3(0.5, 0, 0.2) * TIME_STEPSIZE2);
+			}, options));
+		}
+		name = "ballCollision/" + grid;
+		if(wanted(name)) {
+			Cloth cloth(width, height, size, size);
+			settle(cloth, ball_center, ball_radius);
+			results.push_back(runBenchmark(name, num_particles, [&](long iterations) {
+				for(long i = 0; i < iterations; i++)
+					cloth.ballCollision(ball_center, ball_radius);
+			}, options));
+		}
+		name = "computeNormals/" + grid;
+		if(wanted(name)) {
+			Cloth cloth(width, height, size, size);
+			settle(cloth, ball_center, ball_radius);
+			results.push_back(runBenchmark(name, num_triangles, [&](long iterations) {
+				for(long i = 0; i < iterations; i++)
+					cloth.computeNormals();
+			}, options));
+		}
+	}
+
+	if(output_path != NULL && !writeResults(output_path, results, options)) {
+		fprintf(stderr, "Could not write the results to %s\n", output_path);
+		return 1;
+	}
+
+	// A regression fails the run, so that it can gate a build
+	if(baseline_path != NULL && compareResults(results, baseline, threshold / 100.0) > 0) return 2;
+	return 0;
+}
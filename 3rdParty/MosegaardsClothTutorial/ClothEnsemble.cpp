@@ -0,0 +1,136 @@
+/**
+ * @file ClothEnsemble.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief Sweeps the parameters of the cloth in one process: every combination of the given values is a member of
+ * an ensemble, all the members are stepped on the cores together and their results are written as one table
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Ensemble.h"
+#include "ThreadPool.h"
+
+/* ******************************************************************************************** */
+void usage(const char *name) {
+	printf("Usage: %s [options]\n", name);
+	printf("  -f <frames>       number of frames to simulate (default 300)\n");
+	printf("  -g <w> <h>        particles in the width and height directions (default 55 45)\n");
+	printf("  -s <w> <h>        size of the cloth (default 14 10)\n");
+	printf("  -k <values>       comma separated stiffnesses of the constraints (default 1)\n");
+	printf("  -d <values>       comma separated dampings (default %g)\n", DAMPING);
+	printf("  -x <values>       comma separated x positions of the ball (default 7)\n");
+	printf("  -y <values>       comma separated y positions of the ball (default 1)\n");
+	printf("  -r <values>       comma separated radii of the ball (default 0.5)\n");
+	printf("  -t <threads>      threads to step the members on, 0 for all cores (default 0)\n");
+	printf("  -l <file>         start every member from the state saved in the file (ClothHeadless -w), on its grid\n");
+	printf("  -o <file>         write the results to the file instead of the standard output\n");
+}
+
+/* ******************************************************************************************** */
+std::vector <float> parseList(const char *text) {
+	std::vector <float> values;
+	for(const char *c = text; *c != '\0'; ) {
+		char *end;
+		values.push_back(strtof(c, &end));
+		if(end == c) return std::vector <float>();
+		c = (*end == ',') ? end + 1 : end;
+	}
+	return values;
+}
+
+/* ******************************************************************************************** */
+int main(int argc, char** argv) {
+
+	// Read the options
+	int frames = 300;
+	EnsembleParams base;
+	std::vector <float> stiffnesses(1, base.stiffness), dampings(1, base.damping);
+	std::vector <float> xs(1, base.probe_center.f[0]), ys(1, base.probe_center.f[1]), radii(1, base.probe_radius);
+	int num_threads = 0;
+	const char *output_path = NULL;
+	const char *state_path = NULL;
+	for(int i = 1; i < argc; i++) {
+		if(!strcmp(argv[i], "-f") && i + 1 < argc) frames = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-g") && i + 2 < argc) {
+			base.num_particles_width = atoi(argv[++i]);
+			base.num_particles_height = atoi(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "-s") && i + 2 < argc) {
+			base.width = atof(argv[++i]);
+			base.height = atof(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "-k") && i + 1 < argc) stiffnesses = parseList(argv[++i]);
+		else if(!strcmp(argv[i], "-d") && i + 1 < argc) dampings = parseList(argv[++i]);
+		else if(!strcmp(argv[i], "-x") && i + 1 < argc) xs = parseList(argv[++i]);
+		else if(!strcmp(argv[i], "-y") && i + 1 < argc) ys = parseList(argv[++i]);
+		else if(!strcmp(argv[i], "-r") && i + 1 < argc) radii = parseList(argv[++i]);
+		else if(!strcmp(argv[i], "-t") && i + 1 < argc) num_threads = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-o") && i + 1 < argc) output_path = argv[++i];
+		else if(!strcmp(argv[i], "-l") && i + 1 < argc) state_path = argv[++i];
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if(frames < 1 || base.num_particles_width < 3 || base.num_particles_height < 3 || stiffnesses.empty()
+			|| dampings.empty() || xs.empty() || ys.empty() || radii.empty()) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	// The members forked from a state are on its grid
+	std::shared_ptr <ClothState> state;
+	if(state_path != NULL) {
+		state = std::make_shared <ClothState>();
+		if(!state->load(state_path)) {
+			fprintf(stderr, "Could not read the state %s\n", state_path);
+			return 1;
+		}
+		base.num_particles_width = state->num_particles_width;
+		base.num_particles_height = state->num_particles_height;
+	}
+
+	// Every combination of the values is a member
+	ThreadPool pool(num_threads);
+	Ensemble ensemble(&pool);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(size_t k = 0; k < stiffnesses.size(); k++)
+		for(size_t d = 0; d < dampings.size(); d++)
+			for(size_t x = 0; x < xs.size(); x++)
+				for(size_t y = 0; y < ys.size(); y++)
+					for(size_t r = 0; r < radii.size(); r++) {
+						EnsembleParams params = base;
+						params.stiffness = stiffnesses[k];
+						params.damping = dampings[d];
+						params.probe_center.f[0] = xs[x];
+						params.probe_center.f[1] = ys[y];
+						params.probe_radius = radii[r];
+						if(ensemble.add(params, state) == (size_t) -1) {
+							fprintf(stderr, "The state %s is not of the grid of the members\n", state_path);
+							return 1;
+						}
+					}
+	std::chrono::duration<double> setup = std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	ensemble.run(frames);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	FILE *out = (output_path != NULL) ? fopen(output_path, "w") : stdout;
+	if(out == NULL) {
+		fprintf(stderr, "Could not create %s\n", output_path);
+		return 1;
+	}
+	ensemble.writeResults(out);
+	if(out != stdout) fclose(out);
+
+	// The summary goes to the standard error so that the table can be piped on its own
+	fprintf(stderr, "members: %lu, topologies: %lu, threads: %d, frames: %d, setup: %.3lf s, time: %.3lf s, member steps/s: %.1lf\n",
+			(unsigned long) ensemble.size(), (unsigned long) ensemble.numTopologies(), pool.size(), frames, setup.count(),
+			elapsed.count(), ensemble.size() * frames / elapsed.count());
+	return 0;
+}
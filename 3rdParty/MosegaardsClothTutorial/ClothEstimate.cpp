@@ -0,0 +1,139 @@
+/**
+ * @file ClothEstimate.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief Recovers the ball pressed into the cloth from the shape of the cloth: the shapes of a ball moving through the
+ * cloth are simulated as the observations, and the ball is fit to each of them in turn, starting from the last fit
+ */
+
+#include <algorithm>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ProbeEstimator.h"
+#include "ThreadPool.h"
+
+/* ******************************************************************************************** */
+void usage(const char *name) {
+	ProbeEstimatorParams defaults;
+	printf("Usage: %s [options]\n", name);
+	printf("  -f <frames>       frames each candidate ball is held in the cloth (default %d)\n", defaults.frames);
+	printf("  -g <w> <h>        particles in the width and height directions (default 55 45)\n");
+	printf("  -s <w> <h>        size of the cloth (default 14 10)\n");
+	printf("  -b <x> <y> <z> <r> center and radius of the observed ball (default 7 0.2 -5 1)\n");
+	printf("  -v <x> <y> <z>    how far the observed ball moves between observations (default 0.05 0 0)\n");
+	printf("  -a <x> <y> <z> <r> first guess of the ball (default 6.7 0.4 -4.7 0.8)\n");
+	printf("  -n <observations> number of observations to fit (default 10)\n");
+	printf("  -N <sigma>        standard deviation of the noise added to the observed positions (default 0)\n");
+	printf("  -i <iterations>   most Levenberg-Marquardt iterations per fit (default %d)\n", defaults.max_iterations);
+	printf("  -t <threads>      threads to run the candidates on, 0 for all cores (default 0)\n");
+	printf("  -l <file>         start every candidate from the state saved in the file (ClothHeadless -w), on its grid\n");
+}
+
+/* ******************************************************************************************** */
+int main(int argc, char** argv) {
+
+	// Read the options
+	EnsembleParams cloth;
+	ProbeEstimatorParams params;
+	Vec3 center(7.0, 0.2, -5.0), velocity(0.05, 0.0, 0.0), guess_center(6.7, 0.4, -4.7);
+	float radius = 1.0f, guess_radius = 0.8f;
+	int num_observations = 10;
+	float noise = 0.0f;
+	int num_threads = 0;
+	const char *state_path = NULL;
+	for(int i = 1; i < argc; i++) {
+		if(!strcmp(argv[i], "-f") && i + 1 < argc) params.frames = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-g") && i + 2 < argc) {
+			cloth.num_particles_width = atoi(argv[++i]);
+			cloth.num_particles_height = atoi(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "-s") && i + 2 < argc) {
+			cloth.width = atof(argv[++i]);
+			cloth.height = atof(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "-b") && i + 4 < argc) {
+			for(int k = 0; k < 3; k++) center.f[k] = atof(argv[++i]);
+			radius = atof(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "-v") && i + 3 < argc) {
+			for(int k = 0; k < 3; k++) velocity.f[k] = atof(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "-a") && i + 4 < argc) {
+			for(int k = 0; k < 3; k++) guess_center.f[k] = atof(argv[++i]);
+			guess_radius = atof(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "-n") && i + 1 < argc) num_observations = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-N") && i + 1 < argc) noise = atof(argv[++i]);
+		else if(!strcmp(argv[i], "-i") && i + 1 < argc) params.max_iterations = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-t") && i + 1 < argc) num_threads = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-l") && i + 1 < argc) state_path = argv[++i];
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if(params.frames < 1 || params.max_iterations < 1 || num_observations < 1 || cloth.num_particles_width < 3
+			|| cloth.num_particles_height < 3 || radius <= 0.0f || guess_radius <= 0.0f) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	// The candidates forked from a state are on its grid
+	std::shared_ptr <ClothState> state;
+	if(state_path != NULL) {
+		state = std::make_shared <ClothState>();
+		if(!state->load(state_path)) {
+			fprintf(stderr, "Could not read the state %s\n", state_path);
+			return 1;
+		}
+		cloth.num_particles_width = state->num_particles_width;
+		cloth.num_particles_height = state->num_particles_height;
+	}
+	ThreadPool pool(num_threads);
+	ProbeEstimator estimator(cloth, params, &pool);
+	if(state && !estimator.setStart(state)) {
+		fprintf(stderr, "The state %s is not of the grid of the cloth\n", state_path);
+		return 1;
+	}
+
+	// Fit each observation from the last fit, as a tracker would
+	std::mt19937 random(1);
+	std::normal_distribution <float> gaussian(0.0f, noise);
+	std::vector <Vec3> observed;
+	ProbeEstimate estimate;
+	estimate.center = guess_center;
+	estimate.radius = guess_radius;
+	double total_seconds = 0.0, min_seconds = 0.0, max_seconds = 0.0, total_error = 0.0;
+	size_t total_rollouts = 0;
+	printf("observation\tball_x\tball_y\tball_z\tradius\tfit_x\tfit_y\tfit_z\tfit_radius\trms\titerations\trollouts\tms\n");
+	for(int o = 0; o < num_observations; o++) {
+		estimator.simulate(center, radius, observed);
+		if(noise > 0.0f)
+			for(size_t p = 0; p < observed.size(); p++)
+				for(int k = 0; k < 3; k++)
+					observed[p].f[k] += gaussian(random);
+		estimator.estimate(observed, estimate.center, estimate.radius, estimate);
+		printf("%d\t%g\t%g\t%g\t%g\t%.4f\t%.4f\t%.4f\t%.4f\t%.5f\t%d\t%lu\t%.2lf\n", o, center.f[0], center.f[1],
+				center.f[2], radius, estimate.center.f[0], estimate.center.f[1], estimate.center.f[2], estimate.radius,
+				estimate.error, estimate.iterations, (unsigned long) estimate.rollouts, estimate.seconds * 1e3);
+
+		total_seconds += estimate.seconds;
+		min_seconds = (o == 0) ? estimate.seconds : std::min(min_seconds, estimate.seconds);
+		max_seconds = std::max(max_seconds, estimate.seconds);
+		total_rollouts += estimate.rollouts;
+		total_error += std::max(fabs(estimate.center.f[0] - center.f[0]), std::max(fabs(estimate.center.f[1] - center.f[1]),
+				std::max(fabs(estimate.center.f[2] - center.f[2]), fabs(estimate.radius - radius))));
+		center = center + velocity;
+	}
+
+	// The summary goes to the standard error so that the table can be piped on its own
+	fprintf(stderr, "grid: %dx%d, threads: %d, frames/rollout: %d, fits: %d, latency: %.2lf ms mean, %.2lf min, %.2lf max, "
+			"fits/s: %.1lf, rollouts/fit: %.1lf, mean parameter error: %g\n", cloth.num_particles_width,
+			cloth.num_particles_height, pool.size(), params.frames, num_observations, total_seconds / num_observations * 1e3,
+			min_seconds * 1e3, max_seconds * 1e3, num_observations / total_seconds, total_rollouts / (double) num_observations,
+			total_error / num_observations);
+	return 0;
+}
@@ -0,0 +1,303 @@
+/**
+ * @file ClothHeadless.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief Steps the cloth without any rendering, as fast as the CPU allows, and reports the step rate
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Cloth.h"
+#include "ClothState.h"
+#include "FixedCloth.h"
+#include "MassSpring.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "Trajectory.h"
+#include "TriangleMesh.h"
+
+/* ******************************************************************************************** */
+void usage(const char *name) {
+	printf("Usage: %s [options]\n", name);
+	printf("  -f <frames>       number of frames to simulate (default 1000)\n");
+	printf("  -g <w> <h>        particles in the width and height directions (default 55 45)\n");
+	printf("  -s <w> <h>        size of the cloth (default 14 10)\n");
+	printf("  -b <x> <y> <z> <r> ball center and radius, repeat for more balls (default 7 1 -5 0.5)\n");
+	printf("  -v <x> <y> <z>    velocity of the balls, per frame (default 0 0 0)\n");
+	printf("  -c                continuous collision detection\n");
+	printf("  -t <threads>      threads for the constraint solver, 0 for all cores (default 1)\n");
+	printf("  -m <solver>       constraint solver: gs (Gauss-Seidel) or jacobi, or the mass-spring integrators\n");
+	printf("                    implicit (backward Euler) or explicit (symplectic Euler) (default gs)\n");
+	printf("  -d <seconds>      time step of the mass-spring integrators (default %g)\n", MassSpringParams().time_step);
+	printf("  -K <stiffness>    spring stiffness of the mass-spring integrators (default %g)\n", MassSpringParams().stiffness);
+	printf("  -r <relaxation>   over-relaxation of the jacobi solver (default 1.5)\n");
+	printf("  -i <iterations>   most constraint iterations per frame (default %d)\n", CONSTRAINT_ITERATIONS);
+	printf("  -H <levels> <it>  solve that many coarser lattices first, it iterations each (default none)\n");
+	printf("  -G <g>            gravity pulling the cloth down each frame (default 0)\n");
+	printf("  -e <tolerance>    stop iterating once the largest constraint violation is below this (default 0)\n");
+	printf("  -z <tile> <dist>  put the tiles of tile x tile particles to sleep once no particle moves more than dist\n");
+	printf("                    per frame, the serial gs solver then skips them (default off)\n");
+	printf("  -C <thickness>    self collision, keeping the layers of the cloth that far apart (0: half the shortest\n");
+	printf("                    rest distance)\n");
+	printf("  -D                deterministic mode, the same bits for any number of threads (add -k scalar to also\n");
+	printf("                    match other CPUs)\n");
+	printf("  -a <file>         write the frame number and the hash of the state of the cloth after every frame to the file\n");
+	printf("  -x                use the cloth specialized at compile time for the grid, if there is one\n");
+	printf("  -k <kernel>       constraint kernel: scalar, sse or avx2 (default: best the CPU supports)\n");
+	printf("  -M <file>         a cloth made from the triangles of an OBJ or PLY mesh instead of the grid, with its\n");
+	printf("                    boundary pinned\n");
+	printf("  -u                keep the vertices of the mesh in the order of the file instead of a Morton order\n");
+	printf("  -l <file>         start from the state saved in the file instead of the flat cloth, on its grid\n");
+	printf("  -w <file>         save the state of the cloth after the last frame to the file\n");
+	printf("  -o <file>         record the positions and the tactile images of every frame to a trajectory file\n");
+	printf("  -P <file>         write a Chrome trace of the phases of every frame and print their summary, needs a\n");
+	printf("                    build with CLOTH_ENABLE_PROFILING\n");
+}
+
+/* ******************************************************************************************** */
+int main(int argc, char** argv) {
+
+	// Read the options, the defaults are the scene of the viewer
+	int frames = 1000;
+	int num_particles_width = 55, num_particles_height = 45;
+	float width = 14, height = 10;
+	std::vector <CollisionShape> balls;
+	Vec3 ball_velocity(0, 0, 0);
+	bool continuous_collision = false;
+	SimdLevel simd_level = detectSimdLevel();
+	int num_threads = 1;
+	SolverMode solver_mode = SOLVER_GAUSS_SEIDEL;
+	const char *integrator = NULL;  // the mass-spring integrator instead of the constraint solver
+	MassSpringParams mass_spring;
+	float relaxation = 1.5f;
+	int max_iterations = CONSTRAINT_ITERATIONS;
+	float tolerance = 0.0f;
+	int hierarchy_levels = 0, hierarchy_iterations = 0;
+	float gravity = 0.0f;
+	const char *trajectory_path = NULL;
+	const char *trace_path = NULL;
+	const char *load_path = NULL, *save_path = NULL;
+	const char *mesh_path = NULL;
+	bool reorder = true;
+	bool fixed = false;
+	int sleep_tile_size = 0;
+	float sleep_threshold = 0.0f;
+	bool self_collision = false;
+	float thickness = 0.0f;
+	bool deterministic = false;
+	const char *hash_path = NULL;
+	for(int i = 1; i < argc; i++) {
+		if(!strcmp(argv[i], "-f") && i + 1 < argc) frames = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-g") && i + 2 < argc) {
+			num_particles_width = atoi(argv[++i]);
+			num_particles_height = atoi(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "-s") && i + 2 < argc) {
+			width = atof(argv[++i]);
+			height = atof(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "-b") && i + 4 < argc) {
+			Vec3 ball_pos;
+			for(int k = 0; k < 3; k++) ball_pos.f[k] = atof(argv[++i]);
+			balls.push_back(CollisionShape::sphere(ball_pos, atof(argv[++i])));
+		}
+		else if(!strcmp(argv[i], "-v") && i + 3 < argc) {
+			for(int k = 0; k < 3; k++) ball_velocity.f[k] = atof(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "-c")) continuous_collision = true;
+		else if(!strcmp(argv[i], "-x")) fixed = true;
+		else if(!strcmp(argv[i], "-D")) deterministic = true;
+		else if(!strcmp(argv[i], "-a") && i + 1 < argc) hash_path = argv[++i];
+		else if(!strcmp(argv[i], "-t") && i + 1 < argc) num_threads = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-m") && i + 1 < argc) {
+			const char *name = argv[++i];
+			if(!strcmp(name, "gs")) solver_mode = SOLVER_GAUSS_SEIDEL;
+			else if(!strcmp(name, "jacobi")) solver_mode = SOLVER_JACOBI;
+			else if(!strcmp(name, "implicit") || !strcmp(name, "explicit")) integrator = name;
+			else {
+				usage(argv[0]);
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "-r") && i + 1 < argc) relaxation = atof(argv[++i]);
+		else if(!strcmp(argv[i], "-d") && i + 1 < argc) mass_spring.time_step = atof(argv[++i]);
+		else if(!strcmp(argv[i], "-K") && i + 1 < argc) mass_spring.stiffness = atof(argv[++i]);
+		else if(!strcmp(argv[i], "-i") && i + 1 < argc) max_iterations = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-e") && i + 1 < argc) tolerance = atof(argv[++i]);
+		else if(!strcmp(argv[i], "-H") && i + 2 < argc) {
+			hierarchy_levels = atoi(argv[++i]);
+			hierarchy_iterations = atoi(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "-G") && i + 1 < argc) gravity = atof(argv[++i]);
+		else if(!strcmp(argv[i], "-z") && i + 2 < argc) {
+			sleep_tile_size = atoi(argv[++i]);
+			sleep_threshold = atof(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "-C") && i + 1 < argc) {
+			self_collision = true;
+			thickness = atof(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "-k") && i + 1 < argc) {
+			const char *name = argv[++i];
+			if(!strcmp(name, "scalar")) simd_level = SIMD_SCALAR;
+			else if(!strcmp(name, "sse")) simd_level = SIMD_SSE;
+			else if(!strcmp(name, "avx2")) simd_level = SIMD_AVX2;
+			else {
+				usage(argv[0]);
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i], "-o") && i + 1 < argc) trajectory_path = argv[++i];
+		else if(!strcmp(argv[i], "-P") && i + 1 < argc) trace_path = argv[++i];
+		else if(!strcmp(argv[i], "-M") && i + 1 < argc) mesh_path = argv[++i];
+		else if(!strcmp(argv[i], "-u")) reorder = false;
+		else if(!strcmp(argv[i], "-l") && i + 1 < argc) load_path = argv[++i];
+		else if(!strcmp(argv[i], "-w") && i + 1 < argc) save_path = argv[++i];
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if(frames < 1 || max_iterations < 1 || num_particles_width < 3 || num_particles_height < 3) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if(balls.empty()) balls.push_back(CollisionShape::sphere(Vec3(7.0, 1.0, -5.0), 0.5));
+	TriangleMesh mesh;
+	if(mesh_path != NULL) {
+		if(!mesh.load(mesh_path) || mesh.vertices.empty()) {
+			fprintf(stderr, "Could not read the mesh %s\n", mesh_path);
+			return 1;
+		}
+		if(reorder) mesh.reorderMorton();
+		num_particles_width = (int) mesh.vertices.size();
+		num_particles_height = 1;
+		fixed = false;
+	}
+	ClothState state;
+	if(load_path != NULL) {
+		if(!state.load(load_path)) {
+			fprintf(stderr, "Could not read the state %s\n", load_path);
+			return 1;
+		}
+		if(mesh_path == NULL) {
+			num_particles_width = state.num_particles_width;
+			num_particles_height = state.num_particles_height;
+		}
+	}
+
+	// Step the cloth exactly as display() does in the viewer, minus the drawing
+	std::unique_ptr <Cloth> cloth_pointer = (mesh_path != NULL) ? std::unique_ptr <Cloth>(new Cloth(mesh)) :
+			fixed ? makeCloth(width, height, num_particles_width, num_particles_height) :
+			std::unique_ptr <Cloth>(new Cloth(width, height, num_particles_width, num_particles_height));
+	Cloth &cloth = *cloth_pointer;
+	fixed = fixed && hasFixedCloth(num_particles_width, num_particles_height);
+	cloth.setSimdLevel(simd_level);
+	ThreadPool pool(num_threads);
+	if(pool.size() > 1) cloth.setThreadPool(&pool);
+	cloth.setDeterministic(deterministic);
+	cloth.setSolverMode(solver_mode);
+	cloth.setRelaxation(relaxation);
+	cloth.setMaxIterations(max_iterations);
+	cloth.setTolerance(tolerance);
+	cloth.setContinuousCollision(continuous_collision);
+	cloth.setHierarchyLevels(hierarchy_levels, hierarchy_iterations);
+	cloth.setSelfCollision(self_collision, thickness);
+	if(sleep_tile_size > 0) cloth.setSleeping(true, sleep_tile_size, sleep_threshold);
+	if(load_path != NULL) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if(!cloth.setState(state)) {
+			fprintf(stderr, "The state %s is not of this cloth\n", load_path);
+			return 1;
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		printf("restored %s in %.3lf ms\n", load_path, elapsed.count() * 1e3);
+	}
+	TrajectoryWriter trajectory;
+	if(trajectory_path != NULL && !trajectory.open(trajectory_path, cloth, TRAJECTORY_CONTACTS)) {
+		fprintf(stderr, "Could not create the trajectory file %s\n", trajectory_path);
+		return 1;
+	}
+	FILE *hashes = NULL;
+	if(hash_path != NULL && (hashes = fopen(hash_path, "w")) == NULL) {
+		fprintf(stderr, "Could not create the hash file %s\n", hash_path);
+		return 1;
+	}
+	ChromeTraceWriter trace;
+	if(trace_path != NULL) {
+		if(!profilingEnabled()) fprintf(stderr, "Built without CLOTH_ENABLE_PROFILING, the trace will be empty\n");
+		if(!trace.open(trace_path)) {
+			fprintf(stderr, "Could not create the trace file %s\n", trace_path);
+			return 1;
+		}
+	}
+	ProfileSummary profile;
+	std::vector <ProfileEvent> events;
+	MassSpringIntegrator mass_spring_integrator(cloth, mass_spring);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	long iterations = 0;
+	for(int i = 0; i < frames; i++) {
+		if(gravity != 0.0f) cloth.addForce(Vec3(0.0, -gravity, 0.0) * TIME_STEPSIZE2);  // as the viewer would
+		if(integrator == NULL) cloth.timeStep();
+		else if(!strcmp(integrator, "implicit")) mass_spring_integrator.stepImplicit(cloth);
+		else mass_spring_integrator.stepExplicit(cloth);
+		for(size_t b = 0; b < balls.size(); b++) {
+			balls[b].old_center = balls[b].center;
+			balls[b].center = balls[b].center + ball_velocity;
+		}
+		cloth.collide(balls);
+		iterations += (integrator == NULL) ? cloth.getSolverStats().iterations : mass_spring_integrator.getCGIterations();
+		trajectory.write(cloth);
+		if(hashes != NULL) fprintf(hashes, "%d\t%016llx\n", i, (unsigned long long) cloth.stateHash());
+		if(trace_path != NULL) {  // every frame, so that the ring buffers never wrap around
+			events.clear();
+			Profiler::instance().drain(events);
+			trace.write(events);
+			profile.add(events);
+		}
+	}
+	if(!trajectory.close()) fprintf(stderr, "Could not write all of the trajectory file %s\n", trajectory_path);
+	if(hashes != NULL && fclose(hashes) != 0) fprintf(stderr, "Could not write all of the hash file %s\n", hash_path);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	if(save_path != NULL) {
+		cloth.getState(state);
+		if(!state.save(save_path)) fprintf(stderr, "Could not write the state %s\n", save_path);
+	}
+
+	// Report the rate and a probe of the final state so that runs can be compared
+	Vec3 center = cloth.getParticles().getPos(cloth.getParticle(num_particles_width / 2, num_particles_height / 2));
+	if(mesh_path != NULL)
+		printf("mesh: %s, vertices: %d, triangles: %lu, constraints: %lu, order: %s\n", mesh_path, num_particles_width,
+				(unsigned long) mesh.numTriangles(), (unsigned long) cloth.getTopology()->size(), reorder ? "morton" : "file");
+	printf("grid: %dx%d, solver: %s, kernel: %s, threads: %d, frames: %d, time: %.3lf s, steps/s: %.1lf\n", num_particles_width,
+			num_particles_height, (integrator != NULL) ? integrator : (solver_mode == SOLVER_JACOBI) ? "jacobi" : (fixed && !cloth.getConstraints().isColored()) ? "gs-fixed" : "gs", simdLevelName(cloth.getSimdLevel()), pool.size(), frames, elapsed.count(),
+			frames / elapsed.count());
+	TactileView force = cloth.getTactileView(TactileMap::FORCE);
+	float total_force = 0.0f;
+	for(int y = 0; y < force.height; y++)
+		for(int x = 0; x < force.width; x++)
+			total_force += force.at(x, y);
+	printf("contacts: %lu, total normal force: %g\n", (unsigned long) cloth.getTactileMap().numContacts(), total_force);
+	if(integrator == NULL)
+		printf("iterations/frame: %.2lf, last violation: %g\n", iterations / (double) frames,
+				cloth.getSolverStats().max_violation);
+	else printf("simulated time: %g s, cg iterations/frame: %.2lf, last cg residual: %g\n", frames * mass_spring.time_step,
+			iterations / (double) frames, mass_spring_integrator.getCGResidual());
+	if(cloth.getSleeping())
+		printf("awake tiles: %lu, stepped tiles: %lu of %lu\n", (unsigned long) cloth.getSleepTiles()->numAwake(),
+				(unsigned long) cloth.getSleepTiles()->numStepped(), (unsigned long) cloth.getSleepTiles()->numTiles());
+	if(cloth.getSelfCollision())
+		printf("self contacts: %lu, thickness: %g\n", (unsigned long) cloth.getSelfCollider()->numContacts(),
+				cloth.getSelfCollider()->getThickness());
+	printf("center particle: {%.6f, %.6f, %.6f}\n", center.f[0], center.f[1], center.f[2]);
+	printf("state hash: %016llx%s\n", (unsigned long long) cloth.stateHash(), deterministic ? " (deterministic)" : "");
+	if(trace_path != NULL) {
+		if(!trace.close()) fprintf(stderr, "Could not write all of the trace file %s\n", trace_path);
+		profile.write(stdout);
+	}
+	return 0;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file ClothRenderer.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "ClothRenderer.h"
+
+#include "Profiler.h"
+
+#include <math.h>
+
+/* ******************************************************************************************** */
+void ClothRenderer::buildIndices(const ClothSnapshot &cloth) {
+	width = cloth.width;
+	height = cloth.height;
+	triangles = cloth.triangles.get();
+	if(vertex_buffer == 0) glGenBuffers(1, &vertex_buffer);
+	if(index_buffer == 0) glGenBuffers(1, &index_buffer);
+
+	// The columns of quads alternate between two colors, so the triangles of the even columns and those of the odd
+	// columns are drawn with one call each
+	std::vector <GLuint> indices;
+	if(triangles != NULL) {
+		indices.assign(triangles->begin(), triangles->end());
+		num_even_indices = (GLsizei) indices.size();
+	}
+	else indices.reserve((size_t) 6 * (width - 1) * (height - 1));
+	for(int parity = 0; parity < 2 && triangles == NULL; parity++) {
+		for(int y = 0; y < height - 1; y++) {
+			for(int x = parity; x < width - 1; x += 2) {
+				GLuint p = y * width + x;
+				GLuint triangles[6] = {p + 1, p, p + width, p + width + 1, p + 1, p + width};
+				indices.insert(indices.end(), triangles, triangles + 6);
+			}
+		}
+		if(parity == 0) num_even_indices = (GLsizei) indices.size();
+	}
+	num_odd_indices = (GLsizei) indices.size() - num_even_indices;
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.empty() ? NULL : &indices[0],
+			GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	uploaded_step = 0;
+}
+
+/* ******************************************************************************************** */
+void ClothRenderer::uploadVertices(const ClothSnapshot &cloth) {
+	size_t num_particles = cloth.x.size();
+	size_t size = num_particles * 6 * sizeof(float);
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+
+	// Orphan the buffer so that the driver does not wait for the draws of the last frame, then write into it directly
+	glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+	float *out = (float *) glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+	bool mapped = (out != NULL);
+	if(!mapped) {
+		vertices.resize(num_particles * 6);
+		out = &vertices[0];
+	}
+
+	const float *x = &cloth.x[0], *y = &cloth.y[0], *z = &cloth.z[0];
+	const float *nx = &cloth.normal_x[0], *ny = &cloth.normal_y[0], *nz = &cloth.normal_z[0];
+	for(size_t i = 0; i < num_particles; i++, out += 6) {
+		float scale = 1.0f / sqrtf(nx[i] * nx[i] + ny[i] * ny[i] + nz[i] * nz[i]);
+		out[0] = x[i];
+		out[1] = y[i];
+		out[2] = z[i];
+		out[3] = nx[i] * scale;
+		out[4] = ny[i] * scale;
+		out[5] = nz[i] * scale;
+	}
+
+	if(mapped) glUnmapBuffer(GL_ARRAY_BUFFER);
+	else glBufferSubData(GL_ARRAY_BUFFER, 0, size, &vertices[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	uploaded_step = cloth.step;
+}
+
+/* ******************************************************************************************** */
+void ClothRenderer::drawShaded(const ClothSnapshot &cloth) {
+	CLOTH_PROFILE_SCOPE("drawShaded");
+	if(cloth.step == 0) return;  // nothing published yet
+	if(cloth.width != width || cloth.height != height || cloth.triangles.get() != triangles) buildIndices(cloth);
+	if(cloth.step != uploaded_step) uploadVertices(cloth);  // the simulation may not have stepped since the last frame
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 6 * sizeof(float), (const GLvoid *) 0);
+	glNormalPointer(GL_FLOAT, 6 * sizeof(float), (const GLvoid *) (3 * sizeof(float)));
+
+	// red and white color is interleaved according to which column number
+	glColor3f(1.0f, 1.0f, 1.0f);
+	glDrawElements(GL_TRIANGLES, num_even_indices, GL_UNSIGNED_INT, (const GLvoid *) 0);
+	glColor3f(0.6f, 0.2f, 0.2f);
+	glDrawElements(GL_TRIANGLES, num_odd_indices, GL_UNSIGNED_INT,
+			(const GLvoid *) (num_even_indices * sizeof(GLuint)));
+
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,55 @@
+/**
+ * @file ClothRenderer.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief OpenGL drawing of a Cloth from vertex and index buffers, kept out of the physics library
+ */
+
+#pragma once
+
+#include "SimulationThread.h"
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <vector>
+
+/* Draws the snapshots of a cloth as a triangle mesh. The triangles are indexed from a buffer that is built once for
+ the grid, and each frame only the positions and normals of the particles are streamed into a vertex buffer. It works
+ with any OpenGL 1.5 implementation, Mesa's software rasterizer included (LIBGL_ALWAYS_SOFTWARE=1). The buffers are
+ created in the first drawShaded(), so it needs a current OpenGL context. */
+class ClothRenderer {
+private:
+	GLuint vertex_buffer;  // the position and unit normal of each particle, interleaved
+	GLuint index_buffer;  // the triangles of the even columns of quads, followed by those of the odd columns
+	int width, height;  // of the grid the index buffer was built for
+	const std::vector <uint32_t> *triangles;  // of the mesh the index buffer was built for, NULL for a grid
+	GLsizei num_even_indices, num_odd_indices;
+	uint64_t uploaded_step;  // the step of the snapshot in the vertex buffer
+	std::vector <float> vertices;  // used if the vertex buffer cannot be mapped
+
+	/* Builds the index buffer for the grid of the snapshot, or from the triangles of a mesh, which are all drawn in
+	 the color of the even columns */
+	void buildIndices(const ClothSnapshot &cloth);
+
+	/* Writes the positions and normalized normals of the snapshot into the vertex buffer */
+	void uploadVertices(const ClothSnapshot &cloth);
+
+public:
+
+	ClothRenderer() : vertex_buffer(0), index_buffer(0), width(0), height(0), triangles(NULL),
+			num_even_indices(0), num_odd_indices(0),
+			uploaded_step(0) {}
+
+	/* drawing the cloth as a smooth shaded (and colored according to column) OpenGL triangular mesh
+	 Called from the display() method with the last snapshot of the SimulationThread
+	 The cloth is seen as consisting of triangles for four particles in the grid as follows:
+
+	 (x,y)   *--* (x+1,y)
+	 | /|
+	 |/ |
+	 (x,y+1) *--* (x+1,y+1)
+
+	 */
+	void drawShaded(const ClothSnapshot &cloth);
+};
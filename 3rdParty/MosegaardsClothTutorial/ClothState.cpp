@@ -0,0 +1,166 @@
+/**
+ * @file ClothState.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "ClothState.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+static const char STATE_MAGIC[8] = {'C', 'L', 'O', 'T', 'H', 'S', 'T', 'A'};
+static const uint32_t STATE_VERSION = 2;
+static const uint32_t STATE_BYTE_ORDER = 0x01020304;
+
+/* ******************************************************************************************** */
+static uint64_t pairKey(const ConstraintPair &pair) {
+	return (uint64_t) std::min(pair.p1, pair.p2) << 32 | std::max(pair.p1, pair.p2);
+}
+
+/* ******************************************************************************************** */
+static uint64_t stateTopologyHash(const ClothState &state) {
+	Constraints constraints;
+	constraints.pairs = state.pairs;
+	constraints.rest_distance = state.rest_distance;
+	return constraints.topologyHash();
+}
+
+/* ******************************************************************************************** */
+bool ClothState::matchConstraints(const Constraints &constraints, std::vector <float> &rest) const {
+	if(constraints.size() != pairs.size()) return false;
+
+	// The constraints of the same cloth or of its forks are in the same order
+	size_t c = 0;
+	while(c < pairs.size() && pairKey(pairs[c]) == pairKey(constraints.pairs[c]))
+		c++;
+	if(c == pairs.size()) {
+		rest = rest_distance;
+		return true;
+	}
+
+	// Otherwise look each one up among the sorted pairs of the state
+	std::vector <std::pair <uint64_t, float> > sorted(pairs.size());
+	for(size_t i = 0; i < pairs.size(); i++)
+		sorted[i] = std::make_pair(pairKey(pairs[i]), rest_distance[i]);
+	std::sort(sorted.begin(), sorted.end());
+	rest.resize(constraints.size());
+	for(size_t i = 0; i < constraints.size(); i++) {
+		uint64_t key = pairKey(constraints.pairs[i]);
+		std::vector <std::pair <uint64_t, float> >::const_iterator it = std::lower_bound(sorted.begin(), sorted.end(),
+				std::make_pair(key, -INFINITY));
+		if(it == sorted.end() || it->first != key) return false;
+		rest[i] = it->second;
+	}
+	return true;
+}
+
+/* ******************************************************************************************** */
+void ClothState::write(std::vector <char> &blob) const {
+	const size_t n = numParticles(), m = pairs.size();
+	ClothStateHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, STATE_MAGIC, sizeof(header.magic));
+	header.version = STATE_VERSION;
+	header.byte_order = STATE_BYTE_ORDER;
+	header.width = num_particles_width;
+	header.height = num_particles_height;
+	header.num_constraints = m;
+	header.topology_hash = stateTopologyHash(*this);
+	header.size = sizeof(header) + 7 * n * sizeof(float) + m * (sizeof(ConstraintPair) + sizeof(float));
+
+	blob.resize(header.size);
+	char *out = &blob[0];
+	memcpy(out, &header, sizeof(header));
+	out += sizeof(header);
+	const std::vector <float> *arrays[] = {&x, &y, &z, &old_x, &old_y, &old_z, &inv_mass};
+	for(int a = 0; a < 7; a++, out += n * sizeof(float))
+		if(n > 0) memcpy(out, &(*arrays[a])[0], n * sizeof(float));
+	if(m > 0) {
+		memcpy(out, &pairs[0], m * sizeof(ConstraintPair));
+		memcpy(out + m * sizeof(ConstraintPair), &rest_distance[0], m * sizeof(float));
+	}
+}
+
+/* ******************************************************************************************** */
+bool ClothState::read(const char *data, size_t size) {
+	ClothStateHeader header;
+	if(size < sizeof(header)) return false;
+	memcpy(&header, data, sizeof(header));
+	if(memcmp(header.magic, STATE_MAGIC, sizeof(header.magic)) != 0 || header.version != STATE_VERSION
+			|| header.byte_order != STATE_BYTE_ORDER || header.width < 0 || header.height < 0 || header.size != size)
+		return false;
+	const size_t n = (size_t) header.width * header.height, m = header.num_constraints;
+	if(n > size / (7 * sizeof(float))
+			|| sizeof(header) + 7 * n * sizeof(float) + m * (sizeof(ConstraintPair) + sizeof(float)) != size)
+		return false;
+
+	// Decode into a state of our own, so that this one is left as it was if the data turns out to be damaged
+	ClothState state;
+	state.num_particles_width = header.width;
+	state.num_particles_height = header.height;
+	const char *in = data + sizeof(header);
+	std::vector <float> *arrays[] = {&state.x, &state.y, &state.z, &state.old_x, &state.old_y, &state.old_z,
+			&state.inv_mass};
+	for(int a = 0; a < 7; a++, in += n * sizeof(float)) {
+		arrays[a]->resize(n);
+		if(n > 0) memcpy(&(*arrays[a])[0], in, n * sizeof(float));
+	}
+	state.pairs.resize(m);
+	state.rest_distance.resize(m);
+	if(m > 0) {
+		memcpy(&state.pairs[0], in, m * sizeof(ConstraintPair));
+		memcpy(&state.rest_distance[0], in + m * sizeof(ConstraintPair), m * sizeof(float));
+	}
+
+	// A state that got damaged on the way does not restore
+	for(size_t c = 0; c < m; c++)
+		if(state.pairs[c].p1 >= n || state.pairs[c].p2 >= n) return false;
+	if(stateTopologyHash(state) != header.topology_hash) return false;
+	swap(state);
+	return true;
+}
+
+/* ******************************************************************************************** */
+void ClothState::swap(ClothState &other) {
+	std::swap(num_particles_width, other.num_particles_width);
+	std::swap(num_particles_height, other.num_particles_height);
+	x.swap(other.x);
+	y.swap(other.y);
+	z.swap(other.z);
+	old_x.swap(other.old_x);
+	old_y.swap(other.old_y);
+	old_z.swap(other.old_z);
+	inv_mass.swap(other.inv_mass);
+	pairs.swap(other.pairs);
+	rest_distance.swap(other.rest_distance);
+}
+
+/* ******************************************************************************************** */
+bool ClothState::save(const char *path) const {
+	std::vector <char> blob;
+	write(blob);
+	FILE *file = fopen(path, "wb");
+	if(file == NULL) return false;
+	bool ok = (fwrite(&blob[0], blob.size(), 1, file) == 1);
+	if(fclose(file) != 0) ok = false;
+	return ok;
+}
+
+/* ******************************************************************************************** */
+bool ClothState::load(const char *path) {
+	FILE *file = fopen(path, "rb");
+	if(file == NULL) return false;
+	std::vector <char> blob;
+	bool ok = (fseek(file, 0, SEEK_END) == 0);
+	long size = ok ? ftell(file) : -1;
+	ok = ok && size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+	if(ok) {
+		blob.resize(size);
+		ok = (size == 0 || fread(&blob[0], size, 1, file) == 1);
+	}
+	fclose(file);
+	return ok && read(blob.empty() ? NULL : &blob[0], blob.size());
+}
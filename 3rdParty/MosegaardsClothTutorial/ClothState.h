@@ -0,0 +1,66 @@
+/**
+ * @file ClothState.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief A copy of what the time steps of a cloth change, to restore a settled cloth instead of stepping it there again
+ *
+ * The binary form is a 64 byte header followed by float arrays of num_particles each: x, y, z, old_x, old_y,
+ * old_z and inv_mass, then the constraints as uint32 pairs of particles and their float rest distances. All the
+ * values are in the byte order of the machine that wrote them, which the header records so that a machine of the
+ * other byte order rejects the state instead of misreading it.
+ */
+
+#pragma once
+
+#include "Constraint.h"
+
+#include <stdint.h>
+#include <vector>
+
+/* The header at the start of a state */
+struct ClothStateHeader {
+	char magic[8];  // "CLOTHSTA"
+	uint32_t version;
+	int32_t width, height;  // the particles of the cloth
+	uint32_t num_constraints;
+	uint64_t topology_hash;  // Constraints::topologyHash() of the constraints of the state
+	uint64_t size;  // the bytes of the state, the header included
+	uint32_t byte_order;  // 0x01020304 as the writer stored it, which reads back differently on the other byte order
+	uint8_t reserved[20];
+};
+
+/* The positions, the previous positions and the inverse masses (0 for the pinned particles) of the particles of a
+ cloth, and the rest distances of its constraints. The forces are not kept, they are always cleared by the time
+ step. The constraints are kept with their particles, so that a cloth whose constraints are in another order (e.g.
+ colored for a thread pool) can still be restored from the state, see Cloth::setState(). A state can be restored into
+ any number of cloths of the same grid, they are then forks of the same run. */
+class ClothState {
+public:
+	int num_particles_width, num_particles_height;
+	std::vector <float> x, y, z;
+	std::vector <float> old_x, old_y, old_z;
+	std::vector <float> inv_mass;
+	std::vector <ConstraintPair> pairs;
+	std::vector <float> rest_distance;  // of each of the pairs
+
+	ClothState() : num_particles_width(0), num_particles_height(0) {}
+
+	size_t numParticles() const { return x.size(); }
+
+	/* Finds the rest distances of the state in the order of the given constraints, which must connect the same
+	 particles. Returns false if they do not. */
+	bool matchConstraints(const Constraints &constraints, std::vector <float> &rest) const;
+
+	/* The binary form of the state */
+	void write(std::vector <char> &blob) const;
+
+	/* Reads the binary form of a state, returns false (leaving this state as it was) if the data is not a whole state
+	 of this version and byte order */
+	bool read(const char *data, size_t size);
+
+	void swap(ClothState &other);
+
+	/* write() and read() through a file, false if it cannot be written or read */
+	bool save(const char *path) const;
+	bool load(const char *path);
+};
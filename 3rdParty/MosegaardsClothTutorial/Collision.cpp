@@ -0,0 +1,238 @@
+/**
+ * @file Collision.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "Collision.h"
+
+#include "SleepTiles.h"
+
+#include <algorithm>
+
+/* ******************************************************************************************** */
+CollisionShape CollisionShape::sphere(const Vec3 &center, float radius) {
+	CollisionShape shape = capsule(center, center, radius);
+	shape.type = SHAPE_SPHERE;
+	return shape;
+}
+
+/* ******************************************************************************************** */
+CollisionShape CollisionShape::sweptSphere(const Vec3 &old_center, const Vec3 &center, float radius) {
+	CollisionShape shape = sphere(center, radius);
+	shape.old_center = old_center;
+	return shape;
+}
+
+/* ******************************************************************************************** */
+CollisionShape CollisionShape::capsule(const Vec3 &a, const Vec3 &b, float radius) {
+	CollisionShape shape;
+	shape.type = SHAPE_CAPSULE;
+	shape.center = shape.old_center = a;
+	shape.end = b;
+	shape.axes[0] = Vec3(1, 0, 0);
+	shape.axes[1] = Vec3(0, 1, 0);
+	shape.axes[2] = Vec3(0, 0, 1);
+	shape.half_extents = Vec3(0, 0, 0);
+	shape.radius = radius;
+	return shape;
+}
+
+/* ******************************************************************************************** */
+CollisionShape CollisionShape::box(const Vec3 &center, const Vec3 &half_extents) {
+	return box(center, half_extents, Vec3(1, 0, 0), Vec3(0, 1, 0));
+}
+
+/* ******************************************************************************************** */
+CollisionShape CollisionShape::box(const Vec3 &center, const Vec3 &half_extents, const Vec3 &axis_x,
+		const Vec3 &axis_y) {
+	CollisionShape shape;
+	shape.type = SHAPE_BOX;
+	shape.center = shape.old_center = shape.end = center;
+	shape.half_extents = half_extents;
+	shape.axes[0] = axis_x.normalized();
+	shape.axes[1] = axis_y.normalized();
+	shape.axes[2] = shape.axes[0].cross(shape.axes[1]);
+	shape.radius = 0.0f;
+	return shape;
+}
+
+/* ******************************************************************************************** */
+void CollisionShape::bounds(Vec3 &lo, Vec3 &hi) const {
+	for(int k = 0; k < 3; k++) {
+		if(type == SHAPE_BOX) {
+			float extent = 0.0f;
+			for(int j = 0; j < 3; j++)
+				extent += fabsf(axes[j].f[k]) * half_extents.f[j];
+			lo.f[k] = center.f[k] - extent;
+			hi.f[k] = center.f[k] + extent;
+		}
+		else {
+			lo.f[k] = std::min(std::min(center.f[k], end.f[k]), old_center.f[k]) - radius;
+			hi.f[k] = std::max(std::max(center.f[k], end.f[k]), old_center.f[k]) + radius;
+		}
+	}
+}
+
+/* ******************************************************************************************** */
+bool CollisionShape::penetration(const Vec3 &p, Vec3 &offset) const {
+	switch(type) {
+		case SHAPE_SPHERE:
+		case SHAPE_CAPSULE: {
+
+			// The closest point on the segment is the center of the sphere that touches p
+			Vec3 closest = center;
+			Vec3 segment = end - center;
+			float length2 = segment.dot(segment);
+			if(type == SHAPE_CAPSULE && length2 > 0.0f) {
+				float t = (p - center).dot(segment) / length2;
+				closest = center + segment * std::min(1.0f, std::max(0.0f, t));
+			}
+			Vec3 v = p - closest;
+			float l = v.length();
+			if(l >= radius) return false;  // if the particle is outside the ball
+			if(l == 0.0f) offset = Vec3(0, radius, 0);  // right on the center, push it up
+			else offset = v.normalized() * (radius - l);  // project the particle to the surface of the ball
+			return true;
+		}
+		case SHAPE_BOX: {
+
+			// Push the point out through the closest face
+			Vec3 v = p - center;
+			int face = -1;
+			float depth = 0.0f, side = 0.0f;
+			for(int k = 0; k < 3; k++) {
+				float local = v.dot(axes[k]);
+				float d = half_extents.f[k] - fabsf(local);
+				if(d <= 0.0f) return false;
+				if(face < 0 || d < depth) {
+					face = k;
+					depth = d;
+					side = (local < 0.0f) ? -1.0f : 1.0f;
+				}
+			}
+			offset = axes[face] * (side * depth);
+			return true;
+		}
+	}
+	return false;
+}
+
+/* ******************************************************************************************** */
+bool CollisionShape::sweptPenetration(const Vec3 &p0, const Vec3 &p1, Vec3 &offset) const {
+	if(type != SHAPE_SPHERE) return penetration(p1, offset);
+
+	// In the frame of the sphere the particle moves along r(t) = r0 + t * d, t in [0, 1]
+	Vec3 r0 = p0 - old_center;
+	Vec3 d = (p1 - p0) - (center - old_center);
+	float c = r0.dot(r0) - radius * radius;
+	if(c <= 0.0f) {
+
+		// It started inside (pulled in by the constraints), so there is no time of impact. Push it out along the side of
+		// the sphere it started on rather than the closest one at the end, so that a fast sphere does not let it slip
+		// around to the other side
+		Vec3 r1 = r0 + d;
+		if(r1.dot(r1) >= radius * radius) return false;
+		float l = r0.length();
+		offset = (center + ((l > 0.0f) ? r0 * (radius / l) : Vec3(0, radius, 0))) - p1;
+		return true;
+	}
+
+	// The earliest t where |r(t)| = radius
+	float a = d.dot(d), b = r0.dot(d);
+	float discriminant = b * b - a * c;
+	if(a == 0.0f || b >= 0.0f || discriminant < 0.0f) return false;  // not moving towards the sphere or missing it
+	float t = (-b - sqrtf(discriminant)) / a;
+	if(t > 1.0f) return false;  // does not reach it in this step
+
+	// Stop at the contact point, which then moves with the sphere for the rest of the step
+	Vec3 contact = r0 + d * t;
+	offset = (center + contact) - p1;
+	return true;
+}
+
+/* ******************************************************************************************** */
+void ParticleGrid::setCellSize(float cell_size) {
+	this->cell_size = cell_size;
+	cell.clear();
+}
+
+/* ******************************************************************************************** */
+void ParticleGrid::update(const Particles &particles, const SleepTiles *sleep_tiles) {
+
+	// The grid was emptied or the cloth changed, start over
+	const size_t n = particles.size();
+	bool changed = (cell.size() != 3 * n);
+	if(changed) {
+		cell.assign(3 * n, 0);
+		in_grid.assign(n, 0);
+	}
+
+	float max_motion2 = 0.0f;
+	changed = updateCells(particles, 0, n, true, sleep_tiles, max_motion2) || changed;
+	max_motion = sqrtf(max_motion2);
+	if(changed) rebuild();
+}
+
+/* ******************************************************************************************** */
+void ParticleGrid::update(const Particles &particles, const std::vector <uint32_t> &ranges) {
+	if(cell.size() != 3 * particles.size()) {
+		update(particles);
+		return;
+	}
+	float max_motion2 = 0.0f;
+	bool changed = false;
+	for(size_t r = 0; r + 1 < ranges.size(); r += 2)
+		changed = updateCells(particles, ranges[r], ranges[r + 1], false, NULL, max_motion2) || changed;
+	max_motion = sqrtf(max_motion2);
+	if(changed) rebuild();
+}
+
+/* ******************************************************************************************** */
+bool ParticleGrid::updateCells(const Particles &particles, size_t begin, size_t end, bool movability,
+		const SleepTiles *sleep_tiles, float &max_motion2) {
+	bool changed = false;
+	for(size_t i = begin; i < end; i++) {
+		uint8_t movable = in_grid[i];
+		if(movability) movable = (sleep_tiles ? sleep_tiles->getInvMass(i, particles) : particles.inv_mass[i]) != 0.0f;
+		float mx = particles.x[i] - particles.old_x[i], my = particles.y[i] - particles.old_y[i];
+		float mz = particles.z[i] - particles.old_z[i];
+		max_motion2 = std::max(max_motion2, movable * (mx * mx + my * my + mz * mz));
+		int32_t x = cellOf(particles.x[i]), y = cellOf(particles.y[i]), z = cellOf(particles.z[i]);
+		int32_t *c = &cell[3 * i];
+		if(c[0] != x || c[1] != y || c[2] != z || in_grid[i] != movable) {
+			c[0] = x;
+			c[1] = y;
+			c[2] = z;
+			in_grid[i] = movable;
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+/* ******************************************************************************************** */
+void ParticleGrid::rebuild() {
+	const size_t n = in_grid.size();
+	size_t count = 0;
+	for(size_t i = 0; i < n; i++)
+		count += in_grid[i];
+
+	// Twice as many buckets as particles, so that few cells share a bucket
+	uint32_t num_buckets = 1;
+	while(num_buckets < 2 * count)
+		num_buckets <<= 1;
+	bucket_mask = num_buckets - 1;
+
+	// Counting sort of the particles by bucket
+	bucket_start.assign(num_buckets + 1, 0);
+	for(size_t i = 0; i < n; i++)
+		if(in_grid[i]) bucket_start[(hash(cell[3 * i], cell[3 * i + 1], cell[3 * i + 2]) & bucket_mask) + 1]++;
+	for(uint32_t b = 0; b < num_buckets; b++)
+		bucket_start[b + 1] += bucket_start[b];
+	entries.resize(count);
+	std::vector <uint32_t> next(bucket_start.begin(), bucket_start.end() - 1);
+	for(size_t i = 0; i < n; i++)
+		if(in_grid[i]) entries[next[hash(cell[3 * i], cell[3 * i + 1], cell[3 * i + 2]) & bucket_mask]++] = i;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file Collision.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief Rigid shapes the cloth collides with, and the grid over the particles used to find the
+ * particles near a shape
+ */
+
+#pragma once
+
+#include "Particle.h"
+
+#include <math.h>
+#include <stdint.h>
+
+class SleepTiles;
+
+/* The kinds of rigid shapes */
+enum ShapeType {
+	SHAPE_SPHERE = 0,
+	SHAPE_CAPSULE,  // a segment swept by a sphere
+	SHAPE_BOX  // an oriented box
+};
+
+/* A rigid shape (e.g. one fingertip of a probe) that pushes the particles out of itself */
+struct CollisionShape {
+	ShapeType type;
+	Vec3 center;  // the center of the sphere or the box, the first end of the capsule segment
+	Vec3 old_center;  // the center of the sphere in the previous time step, for continuous collision detection
+	Vec3 end;  // the second end of the capsule segment
+	Vec3 axes[3];  // the unit axes of the box
+	Vec3 half_extents;  // the half sizes of the box along its axes
+	float radius;  // of the sphere or the capsule
+
+	static CollisionShape sphere(const Vec3 &center, float radius);
+	static CollisionShape sweptSphere(const Vec3 &old_center, const Vec3 &center, float radius);  // moved during the step
+	static CollisionShape capsule(const Vec3 &a, const Vec3 &b, float radius);
+	static CollisionShape box(const Vec3 &center, const Vec3 &half_extents);  // axis aligned
+	static CollisionShape box(const Vec3 &center, const Vec3 &half_extents, const Vec3 &axis_x, const Vec3 &axis_y);
+
+	/* The axis aligned bounding box of the shape, covering both of its positions for a swept sphere */
+	void bounds(Vec3 &lo, Vec3 &hi) const;
+
+	/* If the point p is inside the shape, returns true and the offset that moves it to the closest point on the
+	 surface of the shape */
+	bool penetration(const Vec3 &p, Vec3 &offset) const;
+
+	/* Continuous collision of a sphere that moves from old_center to center with a particle that moves from p0 to p1
+	 during the step. If the particle enters the sphere at some point of the step, returns true and the offset that
+	 moves p1 to the point of the surface it hit at the earliest time of impact, carried along with the sphere for the
+	 rest of the step. Particles that already start inside end up where they started on the surface, relative to the
+	 sphere, if they are still inside at the end.
+	 The other shapes fall back to penetration() at p1. */
+	bool sweptPenetration(const Vec3 &p0, const Vec3 &p1, Vec3 &offset) const;
+};
+
+/* A uniform grid over the movable particles, stored as a spatial hash so that its extent is unbounded. The
+ particles are bucketed with a counting sort, which is only redone in update() when a particle has moved to
+ another cell since the last update. */
+class ParticleGrid {
+private:
+	float cell_size;
+	float max_motion;  // the longest distance a particle in the grid has moved in the last time step
+	std::vector <int32_t> cell;  // the cell coordinates of each particle, 3 per particle
+	std::vector <uint8_t> in_grid;  // whether the particle is in the grid (the unmovable ones are not)
+	std::vector <uint32_t> bucket_start;  // the particles of bucket b are entries [bucket_start[b], bucket_start[b+1])
+	std::vector <uint32_t> entries;  // the particle indices, sorted by bucket
+	uint32_t bucket_mask;  // the number of buckets minus 1, a power of 2 minus 1
+
+	static uint32_t hash(int32_t x, int32_t y, int32_t z) {
+		return ((uint32_t) x * 73856093u) ^ ((uint32_t) y * 19349663u) ^ ((uint32_t) z * 83492791u);
+	}
+
+	int32_t cellOf(float v) const { return (int32_t) floorf(v / cell_size); }
+
+	/* Buckets all the particles in the grid */
+	void rebuild();
+
+	/* Finds the cells the particles [begin, end) are in now and how far they moved, and puts them in or out of the
+	 grid if they were pinned or released if movability is true (the frozen particles of sleep_tiles, if not NULL,
+	 count as movable). Returns whether any of them changed. */
+	bool updateCells(const Particles &particles, size_t begin, size_t end, bool movability,
+			const SleepTiles *sleep_tiles, float &max_motion2);
+
+public:
+
+	ParticleGrid() : cell_size(0.0f), max_motion(0.0f), bucket_mask(0) {}
+
+	/* The edge length of the cells, changing it rebuilds the grid on the next update() */
+	void setCellSize(float cell_size);
+	float getCellSize() const { return cell_size; }
+
+	/* Brings the grid up to date with the positions of the particles, and puts the movable ones in it. With
+	 sleep_tiles, the particles of its frozen tiles are in the grid too: they are only pinned until their tile thaws. */
+	void update(const Particles &particles, const SleepTiles *sleep_tiles = NULL);
+
+	/* The same, when only the particles in ranges ([begin, end) pairs) can have moved since the last update. The
+	 particles stay in or out of the grid as they were, even if they were pinned or released since, see SleepTiles, so
+	 the last update has to have been a full one with the same tiles. */
+	void update(const Particles &particles, const std::vector <uint32_t> &ranges);
+
+	/* The longest distance from old_pos to pos of the particles at the last update(). A particle whose path crossed a
+	 region is within this distance of it, so continuous collision queries grow their boxes by it. */
+	float getMaxMotion() const { return max_motion; }
+
+	/* Calls f(particle) once for every particle in the grid whose cell overlaps the box [lo, hi] */
+	template <class Function>
+	void query(const Vec3 &lo, const Vec3 &hi, Function f) const;
+};
+
+/* ******************************************************************************************** */
+template <class Function>
+void ParticleGrid::query(const Vec3 &lo, const Vec3 &hi, Function f) const {
+	if(entries.empty()) return;
+	int32_t lo_cell[3], hi_cell[3];
+	double num_cells = 1.0;
+	for(int k = 0; k < 3; k++) {
+		lo_cell[k] = cellOf(lo.f[k]);
+		hi_cell[k] = cellOf(hi.f[k]);
+		num_cells *= (double) hi_cell[k] - lo_cell[k] + 1;
+	}
+
+	// If the box covers more cells than there are particles, it is cheaper to check every particle
+	if(num_cells > entries.size()) {
+		for(size_t e = 0; e < entries.size(); e++) {
+			const int32_t *c = &cell[3 * entries[e]];
+			if(c[0] >= lo_cell[0] && c[0] <= hi_cell[0] && c[1] >= lo_cell[1] && c[1] <= hi_cell[1] && c[2] >= lo_cell[2]
+					&& c[2] <= hi_cell[2]) f(entries[e]);
+		}
+		return;
+	}
+
+	// Otherwise visit the bucket of each cell, skipping the particles of other cells that share the bucket
+	for(int32_t x = lo_cell[0]; x <= hi_cell[0]; x++) {
+		for(int32_t y = lo_cell[1]; y <= hi_cell[1]; y++) {
+			for(int32_t z = lo_cell[2]; z <= hi_cell[2]; z++) {
+				uint32_t b = hash(x, y, z) & bucket_mask;
+				for(uint32_t e = bucket_start[b]; e < bucket_start[b + 1]; e++) {
+					const int32_t *c = &cell[3 * entries[e]];
+					if(c[0] == x && c[1] == y && c[2] == z) f(entries[e]);
+				}
+			}
+		}
+	}
+}
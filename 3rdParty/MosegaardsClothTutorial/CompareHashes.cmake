@@ -0,0 +1,26 @@
+# Runs two ClothHeadless commands and fails unless they print the same state hash, for the tests of CMakeLists.txt:
+#   cmake [-DPREPARE="<command>"] -DFIRST="<command>" -DSECOND="<command>" -P CompareHashes.cmake
+# The commands are split at spaces. PREPARE runs first, e.g. to write a file the others read, and its hash is ignored.
+
+foreach(run PREPARE FIRST SECOND)
+  if(NOT DEFINED ${run})
+    if(run STREQUAL PREPARE)
+      continue()
+    endif()
+    message(FATAL_ERROR "${run} is not set")
+  endif()
+  separate_arguments(command UNIX_COMMAND "${${run}}")
+  execute_process(COMMAND ${command} RESULT_VARIABLE result OUTPUT_VARIABLE output)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${${run}} failed (${result}):\n${output}")
+  endif()
+  string(REGEX MATCH "state hash: [0-9a-f]+" ${run}_HASH "${output}")
+  if(NOT ${run}_HASH)
+    message(FATAL_ERROR "${${run}} printed no state hash:\n${output}")
+  endif()
+  message(STATUS "${${run}}: ${${run}_HASH}")
+endforeach()
+
+if(NOT FIRST_HASH STREQUAL SECOND_HASH)
+  message(FATAL_ERROR "The runs differ: ${FIRST_HASH} and ${SECOND_HASH}")
+endif()
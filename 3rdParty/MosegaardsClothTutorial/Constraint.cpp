@@ -0,0 +1,156 @@
+/**
+ * @file Constraint.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "Constraint.h"
+
+#include <algorithm>
+#include <deque>
+#include <string.h>
+
+/* ******************************************************************************************** */
+void Constraints::reorder(const std::vector <uint32_t> &order) {
+	std::vector <ConstraintPair> new_pairs(size());
+	std::vector <float> new_rest(size());
+	for(size_t i = 0; i < order.size(); i++) {
+		new_pairs[i] = pairs[order[i]];
+		new_rest[i] = rest_distance[order[i]];
+	}
+	pairs.swap(new_pairs);
+	rest_distance.swap(new_rest);
+	if(hasAdjacency()) buildAdjacency(adjacency_offsets.size() - 1);
+}
+
+/* ******************************************************************************************** */
+uint64_t Constraints::topologyHash() const {
+
+	// Mix each constraint on its own (splitmix64) and add them up so that the order does not matter
+	uint64_t hash = size();
+	for(size_t c = 0; c < size(); c++) {
+		uint32_t rest_bits;
+		memcpy(&rest_bits, &rest_distance[c], sizeof(rest_bits));
+		uint64_t a = std::min(pairs[c].p1, pairs[c].p2), b = std::max(pairs[c].p1, pairs[c].p2);
+		uint64_t z = (a << 32 | b) ^ ((uint64_t) rest_bits * 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		hash += z ^ (z >> 31);
+	}
+	return hash;
+}
+
+/* ******************************************************************************************** */
+void Constraints::buildAdjacency(size_t num_particles) {
+	adjacency_offsets.assign(num_particles + 1, 0);
+	for(size_t c = 0; c < size(); c++) {
+		adjacency_offsets[pairs[c].p1 + 1]++;
+		adjacency_offsets[pairs[c].p2 + 1]++;
+	}
+	for(size_t p = 0; p < num_particles; p++)
+		adjacency_offsets[p + 1] += adjacency_offsets[p];
+	adjacency.resize(2 * size());
+	std::vector <uint32_t> next(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+	for(uint32_t c = 0; c < size(); c++) {
+		adjacency[next[pairs[c].p1]++] = c << 1;
+		adjacency[next[pairs[c].p2]++] = (c << 1) | 1;
+	}
+}
+
+/* ******************************************************************************************** */
+void Constraints::buildBatches() {
+	color_offsets.clear();
+
+	// A batch that is still being filled and the particles it already uses
+	struct OpenBatch {
+		std::vector <uint32_t> members;
+		std::vector <uint32_t> used;
+		bool uses(uint32_t p) const { return std::find(used.begin(), used.end(), p) != used.end(); }
+	};
+	const size_t max_open = 16;  // how far ahead a constraint can be pulled to fill a batch
+	std::deque <OpenBatch> open;
+	std::vector <uint32_t> order, tail;
+	order.reserve(size());
+
+	for(uint32_t c = 0; c < size(); c++) {
+		const uint32_t p1 = pairs[c].p1, p2 = pairs[c].p2;
+
+		// Place the constraint in the oldest open batch that does not use its particles yet
+		bool placed = false;
+		for(size_t b = 0; b < open.size() && !placed; b++) {
+			if(open[b].uses(p1) || open[b].uses(p2)) continue;
+			open[b].used.push_back(p1);
+			open[b].used.push_back(p2);
+			open[b].members.push_back(c);
+			placed = true;
+			if(open[b].members.size() == CONSTRAINT_BATCH) {
+				order.insert(order.end(), open[b].members.begin(), open[b].members.end());
+				open.erase(open.begin() + b);
+			}
+		}
+		if(placed) continue;
+
+		// Otherwise start a new batch, giving up on the oldest one if there are too many
+		if(open.size() == max_open) {
+			tail.insert(tail.end(), open.front().members.begin(), open.front().members.end());
+			open.pop_front();
+		}
+		open.push_back(OpenBatch());
+		open.back().members.push_back(c);
+		open.back().used.push_back(p1);
+		open.back().used.push_back(p2);
+	}
+	for(size_t b = 0; b < open.size(); b++)
+		tail.insert(tail.end(), open[b].members.begin(), open[b].members.end());
+
+	// Apply the new order
+	num_batched = order.size();
+	order.insert(order.end(), tail.begin(), tail.end());
+	reorder(order);
+}
+
+/* ******************************************************************************************** */
+void Constraints::buildColors() {
+
+	// The greedy coloring needs at most 2 * (max constraints per particle) - 1 colors
+	uint32_t num_particles = 0;
+	for(size_t c = 0; c < size(); c++)
+		num_particles = std::max(num_particles, std::max(pairs[c].p1, pairs[c].p2) + 1);
+	std::vector <uint32_t> degree(num_particles, 0);
+	uint32_t max_degree = 0;
+	for(size_t c = 0; c < size(); c++) {
+		max_degree = std::max(max_degree, ++degree[pairs[c].p1]);
+		max_degree = std::max(max_degree, ++degree[pairs[c].p2]);
+	}
+	const size_t words = (2 * max_degree + 63) / 64;
+
+	// Give each constraint the first color neither of its particles has yet, using a bit mask of the
+	// colors of each particle
+	std::vector <uint64_t> used(num_particles * words, 0);
+	std::vector <uint32_t> color(size());
+	size_t num_colors = 0;
+	for(size_t c = 0; c < size(); c++) {
+		uint64_t *used1 = &used[pairs[c].p1 * words], *used2 = &used[pairs[c].p2 * words];
+		size_t k = 0;
+		while(((used1[k / 64] | used2[k / 64]) >> (k % 64)) & 1)
+			k++;
+		used1[k / 64] |= (uint64_t) 1 << (k % 64);
+		used2[k / 64] |= (uint64_t) 1 << (k % 64);
+		color[c] = k;
+		num_colors = std::max(num_colors, k + 1);
+	}
+
+	// Order by color, keeping the original order within a color for locality
+	color_offsets.assign(num_colors + 1, 0);
+	for(size_t c = 0; c < size(); c++)
+		color_offsets[color[c] + 1]++;
+	for(size_t k = 0; k < num_colors; k++)
+		color_offsets[k + 1] += color_offsets[k];
+	std::vector <uint32_t> order(size());
+	std::vector <size_t> next(color_offsets.begin(), color_offsets.end() - 1);
+	for(size_t c = 0; c < size(); c++)
+		order[next[color[c]]++] = c;
+	reorder(order);
+	num_batched = size();
+}
@@ -9,32 +9,136 @@
 
 #include "Particle.h"
 
-class Constraint
+#include <math.h>
+#include <stdint.h>
+
+/* The number of constraints in a batch whose particles are all distinct, so that a batch can be projected
+ with one constraint per SIMD lane (8 for AVX2, two halves of 4 for SSE) */
+#define CONSTRAINT_BATCH 8
+
+/* The two particles, by index, that are connected through a constraint */
+struct ConstraintPair
 {
-private:
-	float rest_distance; // the length between particle p1 and p2 in rest configuration
+	uint32_t p1, p2;
+};
 
+/* The table of distance constraints between particles: packed index pairs plus the rest lengths */
+class Constraints
+{
 public:
-	Particle *p1, *p2; // the two particles that are connected through this constraint
+	std::vector <ConstraintPair> pairs; // the particles connected through each constraint
+	std::vector <float> rest_distance; // the length between particle p1 and p2 in rest configuration
+	size_t num_batched; // the constraints before this index come in groups of CONSTRAINT_BATCH that share no particles
+	std::vector <size_t> color_offsets; // if colored, color c is the constraints [color_offsets[c], color_offsets[c+1])
+	std::vector <uint32_t> adjacency_offsets; // if built, the constraints of particle p are [adjacency_offsets[p], adjacency_offsets[p+1]) in adjacency
+	std::vector <uint32_t> adjacency; // (constraint << 1) | 1 if the particle is p2 of the constraint, | 0 if it is p1
+
+	Constraints() : num_batched(0) {}
+
+	size_t size() const { return pairs.size(); }
+
+	/* Reorders the constraints so that they start with as many batches of CONSTRAINT_BATCH constraints with
+	 distinct particles as possible, followed by a short tail of left over constraints. The batches are filled
+	 greedily in the original order so that the Gauss-Seidel sweep still walks the cloth roughly in order. */
+	void buildBatches();
+
+	/* Reorders the constraints into colors, such that no two constraints of a color share a particle, so
+	 that each color can be projected in parallel (Gauss-Seidel across the colors, Jacobi within one).
+	 Every range inside a color can also be vectorized, num_batched is set to cover all the constraints
+	 but the ranges handed to the vectorized kernels must not span two colors. */
+	void buildColors();
+
+	bool isColored() const { return !color_offsets.empty(); }
+	size_t numColors() const { return isColored() ? color_offsets.size() - 1 : 0; }
+
+	/* Builds the list of constraints of each particle, used by the Jacobi solver to gather the corrections
+	 of a particle without contention. It is kept up to date by reorder(). */
+	void buildAdjacency(size_t num_particles);
+
+	bool hasAdjacency() const { return !adjacency_offsets.empty(); }
+
+	/* A hash of the constraints (the particles they connect and their rest distances) that does not depend on their
+	 order, so that recordings and states can be checked against the topology of a cloth */
+	uint64_t topologyHash() const;
 
-	Constraint(Particle *p1, Particle *p2) :  p1(p1),p2(p2)
+	/* Puts the constraint order[i] at position i */
+	void reorder(const std::vector <uint32_t> &order);
+
+	/* Connects the particles p1 and p2 at their current distance */
+	void add(const Particles &particles, uint32_t p1, uint32_t p2)
 	{
-		Vec3 vec = p1->getPos()-p2->getPos();
-		rest_distance = vec.length();
+		ConstraintPair pair = {p1, p2};
+		pairs.push_back(pair);
+		Vec3 vec = particles.getPos(p1) - particles.getPos(p2);
+		rest_distance.push_back(vec.length());
 	}
 
 	/* This is one of the important methods, where a single constraint between two particles p1 and p2 is solved
-	the method is called by Cloth.time_step() many times per frame*/
-	void satisfyConstraint()
+	the method is called by Cloth.time_step() many times per frame. The stiffness (in [0, 1], 1 for the original cloth)
+	scales how much of the violation is corrected at once. Returns how far the constraint was from being
+	satisfied, as |1 - rest_distance / current_distance|, which the solver uses to stop iterating early */
+	static inline float satisfyConstraint(uint32_t p1, uint32_t p2, float rest_distance, float *x, float *y, float *z,
+			const float *inv_mass, float stiffness)
 	{
-		Vec3 p1_to_p2 = p2->getPos()-p1->getPos(); // vector from p1 to p2
-		float current_distance = p1_to_p2.length(); // current distance between p1 and p2
-		Vec3 correctionVector = p1_to_p2*(1 - rest_distance/current_distance); // The offset vector that could moves p1 into a distance of rest_distance to p2
-		Vec3 correctionVectorHalf = correctionVector*0.25; // Lets make it half that length, so that we can move BOTH p1 and p2.
-		p1->offsetPos(correctionVectorHalf); // correctionVectorHalf is pointing from p1 to p2, so the length should move p1 half the length needed to satisfy the constraint.
-		p2->offsetPos(-correctionVectorHalf); // we must move p2 the negative direction of correctionVectorHalf since it points from p2 to p1, and not p1 to p2.
+		// NOTE: the vectorized kernels in ConstraintKernels*.cpp mirror this computation
+		float dx = x[p2] - x[p1], dy = y[p2] - y[p1], dz = z[p2] - z[p1]; // vector from p1 to p2
+		float current_distance = sqrtf(dx * dx + dy * dy + dz * dz); // current distance between p1 and p2
+
+		// The offset vector that could moves p1 into a distance of rest_distance to p2, scaled down so that we can
+		// move BOTH p1 and p2. Unmovable particles have zero inverse mass and stay in place.
+		float stretch = 1 - rest_distance / current_distance;
+		float scale = stretch * (0.25f * stiffness);
+		float cx = dx * scale, cy = dy * scale, cz = dz * scale;
+		float w1 = inv_mass[p1], w2 = inv_mass[p2];
+		x[p1] += cx * w1; y[p1] += cy * w1; z[p1] += cz * w1;
+		x[p2] -= cx * w2; y[p2] -= cy * w2; z[p2] -= cz * w2;
+		return fabsf(stretch);
 	}
 
-};
+	/* The correction satisfyConstraint() applies to p1 (and the negative of it to p2), without applying it. Used by the
+	 Jacobi solver, which computes all the corrections from the same positions. Returns the violation as
+	 satisfyConstraint() does */
+	static inline float computeCorrection(uint32_t p1, uint32_t p2, float rest_distance, const float *x, const float *y,
+			const float *z, float stiffness, float &cx, float &cy, float &cz)
+	{
+		float dx = x[p2] - x[p1], dy = y[p2] - y[p1], dz = z[p2] - z[p1];
+		float current_distance = sqrtf(dx * dx + dy * dy + dz * dz);
+		float stretch = 1 - rest_distance / current_distance;
+		float scale = stretch * (0.25f * stiffness);
+		cx = dx * scale;
+		cy = dy * scale;
+		cz = dz * scale;
+		return fabsf(stretch);
+	}
 
+	/* Runs computeCorrection() for the constraints [begin, end) and writes the corrections into cx, cy and cz.
+	 Returns the largest violation */
+	float computeCorrectionRange(size_t begin, size_t end, const Particles &particles, float stiffness, float *cx,
+			float *cy, float *cz) const
+	{
+		const float *x = &particles.x[0], *y = &particles.y[0], *z = &particles.z[0];
+		const ConstraintPair *pair = &pairs[0];
+		const float *rest = &rest_distance[0];
+		float max_violation = 0.0f;
+		for(size_t i = begin; i < end; i++)
+			max_violation = fmaxf(max_violation, computeCorrection(pair[i].p1, pair[i].p2, rest[i], x, y, z, stiffness,
+					cx[i], cy[i], cz[i]));
+		return max_violation;
+	}
 
+	/* Runs satisfyConstraint() for the constraints [begin, end) once, in order. Returns the largest violation */
+	float satisfyRange(size_t begin, size_t end, Particles &particles, float stiffness) const
+	{
+		float *x = &particles.x[0], *y = &particles.y[0], *z = &particles.z[0];
+		const float *inv_mass = &particles.inv_mass[0];
+		const ConstraintPair *pair = &pairs[0];
+		const float *rest = &rest_distance[0];
+		float max_violation = 0.0f;
+		for(size_t i = begin; i < end; i++)
+			max_violation = fmaxf(max_violation, satisfyConstraint(pair[i].p1, pair[i].p2, rest[i], x, y, z, inv_mass, stiffness));
+		return max_violation;
+	}
+
+	/* Runs satisfyConstraint() for all the constraints once, in order */
+	float satisfyAll(Particles &particles, float stiffness) const { return satisfyRange(0, size(), particles, stiffness); }
+};
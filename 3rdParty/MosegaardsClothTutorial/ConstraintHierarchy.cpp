@@ -0,0 +1,138 @@
+/**
+ * @file ConstraintHierarchy.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "ConstraintHierarchy.h"
+
+/* ******************************************************************************************** */
+/* The lines of a grid of num lines picked with the stride, always with the last one */
+static std::vector <uint32_t> latticeLines(int num, int stride) {
+	std::vector <uint32_t> lines;
+	for(int i = 0; i < num - 1; i += stride)
+		lines.push_back(i);
+	lines.push_back(num - 1);
+	return lines;
+}
+
+/* ******************************************************************************************** */
+/* For each line of the grid, the lattice line before it and how far it is towards the next one */
+static void interpolation(const std::vector <uint32_t> &lines, int num, std::vector <uint32_t> &cell,
+		std::vector <float> &weight) {
+	cell.resize(num);
+	weight.resize(num);
+	size_t k = 0;
+	for(int i = 0; i < num; i++) {
+		while(k + 2 < lines.size() && (uint32_t) i >= lines[k + 1]) k++;
+		cell[i] = k;
+		weight[i] = (i - (float) lines[k]) / (lines[k + 1] - lines[k]);
+	}
+}
+
+/* ******************************************************************************************** */
+ConstraintHierarchy::ConstraintHierarchy(float width, float height, int num_particles_width, int num_particles_height,
+		int num_levels, int iterations) : num_particles_width(num_particles_width), iterations(iterations) {
+
+	// The particles at rest, as the Cloth constructor puts them
+	Particles rest;
+	rest.resize((size_t) num_particles_width * num_particles_height);
+	for(int y = 0; y < num_particles_height; y++)
+		for(int x = 0; x < num_particles_width; x++)
+			rest.setPos(y * num_particles_width + x, Vec3(width * (x / (float) num_particles_width), 0.0,
+					-height * (y / (float) num_particles_height)));
+
+	for(int l = 1, stride = 2; l <= num_levels; l++, stride *= 2) {
+		Level level;
+		level.columns = latticeLines(num_particles_width, stride);
+		level.rows = latticeLines(num_particles_height, stride);
+		if(level.columns.size() < 3 || level.rows.size() < 3) break;
+		size_t w = level.columns.size(), h = level.rows.size();
+		for(size_t j = 0; j < h; j++)
+			for(size_t i = 0; i < w; i++)
+				level.nodes.push_back(level.rows[j] * num_particles_width + level.columns[i]);
+
+		// Connect each node to the next ones of the lattice, as the Cloth constructor does for the immediate neighbors
+		for(size_t j = 0; j < h; j++) {
+			for(size_t i = 0; i < w; i++) {
+				uint32_t p = level.nodes[j * w + i];
+				if(i + 1 < w) level.constraints.add(rest, p, level.nodes[j * w + i + 1]);
+				if(j + 1 < h) level.constraints.add(rest, p, level.nodes[(j + 1) * w + i]);
+				if(i + 1 < w && j + 1 < h) {
+					level.constraints.add(rest, p, level.nodes[(j + 1) * w + i + 1]);
+					level.constraints.add(rest, level.nodes[j * w + i + 1], level.nodes[(j + 1) * w + i]);
+				}
+			}
+		}
+		level.constraints.buildBatches();
+
+		interpolation(level.columns, num_particles_width, level.cell_x, level.weight_x);
+		interpolation(level.rows, num_particles_height, level.cell_y, level.weight_y);
+		level.dx.resize(level.nodes.size());
+		level.dy.resize(level.nodes.size());
+		level.dz.resize(level.nodes.size());
+		levels.push_back(level);
+	}
+}
+
+/* ******************************************************************************************** */
+size_t ConstraintHierarchy::numConstraints() const {
+	size_t total = 0;
+	for(size_t l = 0; l < levels.size(); l++)
+		total += levels[l].constraints.size();
+	return total;
+}
+
+/* ******************************************************************************************** */
+void ConstraintHierarchy::solve(Particles &particles, float stiffness, SimdLevel simd_level) {
+	float *x = &particles.x[0], *y = &particles.y[0], *z = &particles.z[0];
+	const float *inv_mass = &particles.inv_mass[0];
+	for(size_t l = levels.size(); l-- > 0; ) {
+		Level &level = levels[l];
+		const size_t num_nodes = level.nodes.size();
+		float *dx = &level.dx[0], *dy = &level.dy[0], *dz = &level.dz[0];
+
+		// Satisfy the lattice and keep how its nodes moved, putting them back where they were
+		for(size_t k = 0; k < num_nodes; k++) {
+			uint32_t p = level.nodes[k];
+			dx[k] = x[p];
+			dy[k] = y[p];
+			dz[k] = z[p];
+		}
+		for(int i = 0; i < iterations; i++)
+			satisfyConstraints(level.constraints, 0, level.constraints.size(), particles, stiffness, simd_level);
+		for(size_t k = 0; k < num_nodes; k++) {
+			uint32_t p = level.nodes[k];
+			float old_x = dx[k], old_y = dy[k], old_z = dz[k];
+			dx[k] = x[p] - old_x;
+			dy[k] = y[p] - old_y;
+			dz[k] = z[p] - old_z;
+			x[p] = old_x;
+			y[p] = old_y;
+			z[p] = old_z;
+		}
+
+		// Move every particle by the bilinear interpolation of the moves of the four nodes around it, the nodes
+		// themselves get their own move back
+		const size_t w = level.columns.size();
+		const size_t num_rows = particles.size() / num_particles_width;
+		for(size_t row = 0; row < num_rows; row++) {
+			size_t cy = level.cell_y[row];
+			float wy = level.weight_y[row];
+			const float *dx0 = dx + cy * w, *dy0 = dy + cy * w, *dz0 = dz + cy * w;
+			const float *dx1 = dx0 + w, *dy1 = dy0 + w, *dz1 = dz0 + w;
+			size_t p = row * num_particles_width;
+			for(int column = 0; column < num_particles_width; column++, p++) {
+				size_t cx = level.cell_x[column];
+				float wx = level.weight_x[column];
+				float movable = (inv_mass[p] != 0.0f) ? 1.0f : 0.0f;
+				float w00 = (1 - wx) * (1 - wy) * movable, w10 = wx * (1 - wy) * movable;
+				float w01 = (1 - wx) * wy * movable, w11 = wx * wy * movable;
+				x[p] += w00 * dx0[cx] + w10 * dx0[cx + 1] + w01 * dx1[cx] + w11 * dx1[cx + 1];
+				y[p] += w00 * dy0[cx] + w10 * dy0[cx + 1] + w01 * dy1[cx] + w11 * dy1[cx + 1];
+				z[p] += w00 * dz0[cx] + w10 * dz0[cx + 1] + w01 * dz1[cx] + w11 * dz1[cx + 1];
+			}
+		}
+	}
+}
@@ -0,0 +1,50 @@
+/**
+ * @file ConstraintHierarchy.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief Coarser lattices over the particles of a cloth, to spread the constraint corrections faster
+ */
+
+#pragma once
+
+#include "ConstraintKernels.h"
+
+/* Gauss-Seidel moves a correction only one constraint further per sweep, so on fine grids the cloth stays stretchy
+ after the usual number of iterations. The hierarchy picks every 2nd, 4th, 8th, ... particle of the grid in both
+ directions (and the last row and column) as coarser lattices, and connects each lattice with its own constraints
+ (to the next particle of the lattice, straight and diagonally) at their rest distance. Each time step, solve() satisfies
+ the coarsest lattice first and interpolates (bilinearly) how its particles moved onto all the particles in between,
+ then does the same with the finer lattices. The fine constraints then only have to fix the short range errors. */
+class ConstraintHierarchy {
+private:
+
+	/* A coarse lattice of the particles */
+	struct Level {
+		std::vector <uint32_t> columns, rows;  // the columns and rows of the grid in the lattice
+		std::vector <uint32_t> nodes;  // the particles of the lattice, row by row
+		Constraints constraints;  // between the nodes, batched for the vectorized kernels
+		std::vector <uint32_t> cell_x, cell_y;  // the lattice column and row before each column and row of the grid
+		std::vector <float> weight_x, weight_y;  // how far each column and row of the grid is towards the next one of the lattice
+		std::vector <float> dx, dy, dz;  // how the nodes moved in the last solve()
+	};
+
+	int num_particles_width;
+	std::vector <Level> levels;  // the finest first
+	int iterations;  // the sweeps over the constraints of each lattice
+
+public:
+
+	/* Builds up to num_levels lattices for the grid of the Cloth constructor (stopping before a lattice gets fewer
+	 than 3 nodes across), with the constraints of each swept iterations times */
+	ConstraintHierarchy(float width, float height, int num_particles_width, int num_particles_height, int num_levels,
+			int iterations);
+
+	size_t numLevels() const { return levels.size(); }
+	int getIterations() const { return iterations; }
+
+	/* The constraints of all the lattices together, the extra work per time step is this times the iterations */
+	size_t numConstraints() const;
+
+	/* Satisfies the lattices from the coarsest to the finest and moves the particles in between with them */
+	void solve(Particles &particles, float stiffness, SimdLevel simd_level);
+};
@@ -0,0 +1,71 @@
+/**
+ * @file ConstraintKernels.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "ConstraintKernels.h"
+
+#include <algorithm>
+
+/* ******************************************************************************************** */
+SimdLevel detectSimdLevel() {
+	static const SimdLevel level = []() {
+		Constraints empty;
+		Particles none;
+		float max_violation;
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("avx2") && satisfyBatchesAVX2(empty, 0, 0, none, 1.0f, max_violation)) return SIMD_AVX2;
+		if(__builtin_cpu_supports("sse2") && satisfyBatchesSSE(empty, 0, 0, none, 1.0f, max_violation)) return SIMD_SSE;
+#endif
+		return SIMD_SCALAR;
+	}();
+	return level;
+}
+
+/* ******************************************************************************************** */
+const char* simdLevelName(SimdLevel level) {
+	switch(level) {
+		case SIMD_SSE: return "sse";
+		case SIMD_AVX2: return "avx2";
+		default: return "scalar";
+	}
+}
+
+/* ******************************************************************************************** */
+float satisfyConstraints(const Constraints &constraints, size_t begin, size_t end, Particles &particles,
+		float stiffness, SimdLevel level) {
+	float max_violation = 0.0f;
+
+	// Vectorize the whole batches in the range
+	if(level != SIMD_SCALAR) {
+		size_t batch_begin = (begin + CONSTRAINT_BATCH - 1) / CONSTRAINT_BATCH * CONSTRAINT_BATCH;
+		size_t batch_end = std::min(end, constraints.num_batched) / CONSTRAINT_BATCH * CONSTRAINT_BATCH;
+		if(batch_begin < batch_end) {
+			bool done = (level == SIMD_AVX2) ?
+					satisfyBatchesAVX2(constraints, batch_begin, batch_end, particles, stiffness, max_violation) :
+					satisfyBatchesSSE(constraints, batch_begin, batch_end, particles, stiffness, max_violation);
+			if(done) {
+				max_violation = fmaxf(max_violation, constraints.satisfyRange(begin, batch_begin, particles, stiffness));
+				return fmaxf(max_violation, constraints.satisfyRange(batch_end, end, particles, stiffness));
+			}
+		}
+	}
+	return constraints.satisfyRange(begin, end, particles, stiffness);
+}
+
+/* ******************************************************************************************** */
+float computeCorrections(const Constraints &constraints, size_t begin, size_t end, const Particles &particles,
+		float stiffness, float *cx, float *cy, float *cz, SimdLevel level) {
+	size_t vector_end = begin + (end - begin) / CONSTRAINT_BATCH * CONSTRAINT_BATCH;
+	float max_violation = 0.0f;
+	bool done = false;
+	if(level == SIMD_AVX2)
+		done = computeCorrectionsAVX2(constraints, begin, vector_end, particles, stiffness, cx, cy, cz, max_violation);
+	else if(level == SIMD_SSE)
+		done = computeCorrectionsSSE(constraints, begin, vector_end, particles, stiffness, cx, cy, cz, max_violation);
+	return fmaxf(max_violation, constraints.computeCorrectionRange(done ? vector_end : begin, end, particles,
+			stiffness, cx, cy, cz));
+}
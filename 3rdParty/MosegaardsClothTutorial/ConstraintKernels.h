@@ -0,0 +1,55 @@
+/**
+ * @file ConstraintKernels.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief Vectorized constraint projection, selected at runtime from the features of the CPU
+ *
+ * The SIMD kernels project CONSTRAINT_BATCH independent constraints at a time (see
+ * Constraints::buildBatches()). Instead of the sqrt and divide of the scalar kernel they use the
+ * reciprocal square root estimate refined with one Newton step, which is accurate to about 2^-22
+ * relative. Each correction therefore matches the scalar kernel to within 1e-6 of the rest length. After
+ * one frame of CONSTRAINT_ITERATIONS sweeps the particle positions agree with the scalar kernel to within
+ * 1e-6 of the grid spacing, and the differences stay below 1e-3 of the grid spacing over 300 frames of the
+ * viewer's scene (55x45 and 200x163 grids).
+ */
+
+#pragma once
+
+#include "Constraint.h"
+
+/* The instruction sets the constraint projection can use */
+enum SimdLevel {
+	SIMD_SCALAR = 0,
+	SIMD_SSE,  // 4 constraints per instruction
+	SIMD_AVX2  // 8 constraints per instruction, with gathers
+};
+
+/* Returns the best level that both this build and the CPU we are running on support */
+SimdLevel detectSimdLevel();
+
+/* Returns "scalar", "sse" or "avx2" */
+const char* simdLevelName(SimdLevel level);
+
+/* Projects the constraints [begin, end) once, in order, with the given instruction set. The batched
+ constraints (up to Constraints::num_batched) are vectorized and the rest run through the scalar kernel.
+ Returns the largest violation of the constraints, see Constraints::satisfyConstraint() for the stiffness. */
+float satisfyConstraints(const Constraints &constraints, size_t begin, size_t end, Particles &particles,
+		float stiffness, SimdLevel level);
+
+/* Computes the corrections of the constraints [begin, end) from the current positions, without moving the
+ particles, for the Jacobi solver. The range can be anywhere. Returns the largest violation. */
+float computeCorrections(const Constraints &constraints, size_t begin, size_t end, const Particles &particles,
+		float stiffness, float *cx, float *cy, float *cz, SimdLevel level);
+
+/* The per instruction set kernels. For the satisfy kernels, begin and end must be multiples of
+ CONSTRAINT_BATCH within the batched constraints; the correction kernels take any range whose length is a
+ multiple of CONSTRAINT_BATCH. They raise max_violation to the largest violation they see, and return false without doing
+ anything if the kernel was not compiled into this build. */
+bool satisfyBatchesSSE(const Constraints &constraints, size_t begin, size_t end, Particles &particles, float stiffness,
+		float &max_violation);
+bool satisfyBatchesAVX2(const Constraints &constraints, size_t begin, size_t end, Particles &particles, float stiffness,
+		float &max_violation);
+bool computeCorrectionsSSE(const Constraints &constraints, size_t begin, size_t end, const Particles &particles,
+		float stiffness, float *cx, float *cy, float *cz, float &max_violation);
+bool computeCorrectionsAVX2(const Constraints &constraints, size_t begin, size_t end, const Particles &particles,
+		float stiffness, float *cx, float *cy, float *cz, float &max_violation);
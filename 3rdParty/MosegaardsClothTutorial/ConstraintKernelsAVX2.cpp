@@ -0,0 +1,128 @@
+/**
+ * @file ConstraintKernelsAVX2.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief This file is compiled with -mavx2, its kernel is only called after checking the CPU supports it
+ */
+
+#include "ConstraintKernels.h"
+
+#include <math.h>
+
+#ifdef __AVX2__
+
+#include <immintrin.h>
+
+/* ******************************************************************************************** */
+bool satisfyBatchesAVX2(const Constraints &constraints, size_t begin, size_t end, Particles &particles, float stiffness,
+		float &max_violation) {
+	if(begin >= end) return true;
+	float *x = &particles.x[0], *y = &particles.y[0], *z = &particles.z[0];
+	const float *inv_mass = &particles.inv_mass[0];
+	const int *pairs = (const int *) &constraints.pairs[0];
+	const float *rest = &constraints.rest_distance[0];
+	const __m256 one = _mm256_set1_ps(1.0f), half = _mm256_set1_ps(0.5f), three_halves = _mm256_set1_ps(1.5f);
+	const __m256 factor = _mm256_set1_ps(0.25f * stiffness);
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+	__m256 violation = _mm256_setzero_ps();
+	const __m256i deinterleave = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+	int idx[2][8] __attribute__((aligned(32)));
+	float out[6][8] __attribute__((aligned(32)));
+
+	for(size_t i = begin; i < end; i += CONSTRAINT_BATCH) {
+
+		// Split the packed pairs into the indices of the first and the second particles
+		__m256i a = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *) (pairs + 2 * i)), deinterleave);
+		__m256i b = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *) (pairs + 2 * i + 8)), deinterleave);
+		__m256i i1 = _mm256_permute2x128_si256(a, b, 0x20);
+		__m256i i2 = _mm256_permute2x128_si256(a, b, 0x31);
+		_mm256_store_si256((__m256i *) idx[0], i1);
+		_mm256_store_si256((__m256i *) idx[1], i2);
+
+		// Gather the particles of the 8 constraints
+		__m256 x1 = _mm256_i32gather_ps(x, i1, 4), y1 = _mm256_i32gather_ps(y, i1, 4), z1 = _mm256_i32gather_ps(z, i1, 4);
+		__m256 x2 = _mm256_i32gather_ps(x, i2, 4), y2 = _mm256_i32gather_ps(y, i2, 4), z2 = _mm256_i32gather_ps(z, i2, 4);
+		__m256 w1 = _mm256_i32gather_ps(inv_mass, i1, 4), w2 = _mm256_i32gather_ps(inv_mass, i2, 4);
+
+		// The inverse of the current distance with the estimate refined by a Newton step
+		__m256 dx = _mm256_sub_ps(x2, x1), dy = _mm256_sub_ps(y2, y1), dz = _mm256_sub_ps(z2, z1);
+		__m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+		__m256 r = _mm256_rsqrt_ps(d2);
+		r = _mm256_mul_ps(r, _mm256_sub_ps(three_halves, _mm256_mul_ps(_mm256_mul_ps(half, d2), _mm256_mul_ps(r, r))));
+
+		// The correction as in Constraints::satisfyConstraint(), scattered back one lane at a time
+		__m256 stretch = _mm256_sub_ps(one, _mm256_mul_ps(_mm256_loadu_ps(rest + i), r));
+		__m256 scale = _mm256_mul_ps(stretch, factor);
+		violation = _mm256_max_ps(violation, _mm256_andnot_ps(sign, stretch));
+		__m256 cx = _mm256_mul_ps(dx, scale), cy = _mm256_mul_ps(dy, scale), cz = _mm256_mul_ps(dz, scale);
+		_mm256_store_ps(out[0], _mm256_add_ps(x1, _mm256_mul_ps(cx, w1)));
+		_mm256_store_ps(out[1], _mm256_add_ps(y1, _mm256_mul_ps(cy, w1)));
+		_mm256_store_ps(out[2], _mm256_add_ps(z1, _mm256_mul_ps(cz, w1)));
+		_mm256_store_ps(out[3], _mm256_sub_ps(x2, _mm256_mul_ps(cx, w2)));
+		_mm256_store_ps(out[4], _mm256_sub_ps(y2, _mm256_mul_ps(cy, w2)));
+		_mm256_store_ps(out[5], _mm256_sub_ps(z2, _mm256_mul_ps(cz, w2)));
+		for(int k = 0; k < 8; k++) {
+			x[idx[0][k]] = out[0][k]; y[idx[0][k]] = out[1][k]; z[idx[0][k]] = out[2][k];
+			x[idx[1][k]] = out[3][k]; y[idx[1][k]] = out[4][k]; z[idx[1][k]] = out[5][k];
+		}
+	}
+	float lanes[8] __attribute__((aligned(32)));
+	_mm256_store_ps(lanes, violation);
+	for(int k = 0; k < 8; k++)
+		max_violation = fmaxf(max_violation, lanes[k]);
+	return true;
+}
+
+/* ******************************************************************************************** */
+bool computeCorrectionsAVX2(const Constraints &constraints, size_t begin, size_t end, const Particles &particles,
+		float stiffness, float *cx, float *cy, float *cz, float &max_violation) {
+	if(begin >= end) return true;
+	const float *x = &particles.x[0], *y = &particles.y[0], *z = &particles.z[0];
+	const int *pairs = (const int *) &constraints.pairs[0];
+	const float *rest = &constraints.rest_distance[0];
+	const __m256 one = _mm256_set1_ps(1.0f), half = _mm256_set1_ps(0.5f), three_halves = _mm256_set1_ps(1.5f);
+	const __m256 factor = _mm256_set1_ps(0.25f * stiffness);
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+	__m256 violation = _mm256_setzero_ps();
+	const __m256i deinterleave = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+	for(size_t i = begin; i < end; i += CONSTRAINT_BATCH) {
+		__m256i a = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *) (pairs + 2 * i)), deinterleave);
+		__m256i b = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *) (pairs + 2 * i + 8)), deinterleave);
+		__m256i i1 = _mm256_permute2x128_si256(a, b, 0x20);
+		__m256i i2 = _mm256_permute2x128_si256(a, b, 0x31);
+		__m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(x, i2, 4), _mm256_i32gather_ps(x, i1, 4));
+		__m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(y, i2, 4), _mm256_i32gather_ps(y, i1, 4));
+		__m256 dz = _mm256_sub_ps(_mm256_i32gather_ps(z, i2, 4), _mm256_i32gather_ps(z, i1, 4));
+		__m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+		__m256 r = _mm256_rsqrt_ps(d2);
+		r = _mm256_mul_ps(r, _mm256_sub_ps(three_halves, _mm256_mul_ps(_mm256_mul_ps(half, d2), _mm256_mul_ps(r, r))));
+		__m256 stretch = _mm256_sub_ps(one, _mm256_mul_ps(_mm256_loadu_ps(rest + i), r));
+		__m256 scale = _mm256_mul_ps(stretch, factor);
+		violation = _mm256_max_ps(violation, _mm256_andnot_ps(sign, stretch));
+		_mm256_storeu_ps(cx + i, _mm256_mul_ps(dx, scale));
+		_mm256_storeu_ps(cy + i, _mm256_mul_ps(dy, scale));
+		_mm256_storeu_ps(cz + i, _mm256_mul_ps(dz, scale));
+	}
+	float lanes[8] __attribute__((aligned(32)));
+	_mm256_store_ps(lanes, violation);
+	for(int k = 0; k < 8; k++)
+		max_violation = fmaxf(max_violation, lanes[k]);
+	return true;
+}
+
+#else
+
+/* ******************************************************************************************** */
+bool satisfyBatchesAVX2(const Constraints &constraints, size_t begin, size_t end, Particles &particles, float stiffness,
+		float &max_violation) {
+	return false;
+}
+
+/* ******************************************************************************************** */
+bool computeCorrectionsAVX2(const Constraints &constraints, size_t begin, size_t end, const Particles &particles,
+		float stiffness, float *cx, float *cy, float *cz, float &max_violation) {
+	return false;
+}
+
+#endif
@@ -0,0 +1,124 @@
+/**
+ * @file ConstraintKernelsSSE.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "ConstraintKernels.h"
+
+#include <math.h>
+
+#ifdef __SSE2__
+
+#include <emmintrin.h>
+
+/* ******************************************************************************************** */
+bool satisfyBatchesSSE(const Constraints &constraints, size_t begin, size_t end, Particles &particles, float stiffness,
+		float &max_violation) {
+	if(begin >= end) return true;
+	float *x = &particles.x[0], *y = &particles.y[0], *z = &particles.z[0];
+	const float *inv_mass = &particles.inv_mass[0];
+	const ConstraintPair *pairs = &constraints.pairs[0];
+	const float *rest = &constraints.rest_distance[0];
+	const __m128 one = _mm_set1_ps(1.0f), half = _mm_set1_ps(0.5f), three_halves = _mm_set1_ps(1.5f);
+	const __m128 factor = _mm_set1_ps(0.25f * stiffness);
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	__m128 violation = _mm_setzero_ps();
+	float out[6][4] __attribute__((aligned(16)));
+
+	// A batch of 8 has distinct particles so each half of it can be done with 4 lanes
+	for(size_t i = begin; i < end; i += 4) {
+		const ConstraintPair *c = pairs + i;
+
+		// Load the particles of the 4 constraints (SSE has no gathers)
+		__m128 x1 = _mm_setr_ps(x[c[0].p1], x[c[1].p1], x[c[2].p1], x[c[3].p1]);
+		__m128 y1 = _mm_setr_ps(y[c[0].p1], y[c[1].p1], y[c[2].p1], y[c[3].p1]);
+		__m128 z1 = _mm_setr_ps(z[c[0].p1], z[c[1].p1], z[c[2].p1], z[c[3].p1]);
+		__m128 w1 = _mm_setr_ps(inv_mass[c[0].p1], inv_mass[c[1].p1], inv_mass[c[2].p1], inv_mass[c[3].p1]);
+		__m128 x2 = _mm_setr_ps(x[c[0].p2], x[c[1].p2], x[c[2].p2], x[c[3].p2]);
+		__m128 y2 = _mm_setr_ps(y[c[0].p2], y[c[1].p2], y[c[2].p2], y[c[3].p2]);
+		__m128 z2 = _mm_setr_ps(z[c[0].p2], z[c[1].p2], z[c[2].p2], z[c[3].p2]);
+		__m128 w2 = _mm_setr_ps(inv_mass[c[0].p2], inv_mass[c[1].p2], inv_mass[c[2].p2], inv_mass[c[3].p2]);
+
+		// The inverse of the current distance with the estimate refined by a Newton step
+		__m128 dx = _mm_sub_ps(x2, x1), dy = _mm_sub_ps(y2, y1), dz = _mm_sub_ps(z2, z1);
+		__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		__m128 r = _mm_rsqrt_ps(d2);
+		r = _mm_mul_ps(r, _mm_sub_ps(three_halves, _mm_mul_ps(_mm_mul_ps(half, d2), _mm_mul_ps(r, r))));
+
+		// The correction as in Constraints::satisfyConstraint()
+		__m128 stretch = _mm_sub_ps(one, _mm_mul_ps(_mm_loadu_ps(rest + i), r));
+		__m128 scale = _mm_mul_ps(stretch, factor);
+		violation = _mm_max_ps(violation, _mm_andnot_ps(sign, stretch));
+		__m128 cx = _mm_mul_ps(dx, scale), cy = _mm_mul_ps(dy, scale), cz = _mm_mul_ps(dz, scale);
+		_mm_store_ps(out[0], _mm_add_ps(x1, _mm_mul_ps(cx, w1)));
+		_mm_store_ps(out[1], _mm_add_ps(y1, _mm_mul_ps(cy, w1)));
+		_mm_store_ps(out[2], _mm_add_ps(z1, _mm_mul_ps(cz, w1)));
+		_mm_store_ps(out[3], _mm_sub_ps(x2, _mm_mul_ps(cx, w2)));
+		_mm_store_ps(out[4], _mm_sub_ps(y2, _mm_mul_ps(cy, w2)));
+		_mm_store_ps(out[5], _mm_sub_ps(z2, _mm_mul_ps(cz, w2)));
+		for(int k = 0; k < 4; k++) {
+			x[c[k].p1] = out[0][k]; y[c[k].p1] = out[1][k]; z[c[k].p1] = out[2][k];
+			x[c[k].p2] = out[3][k]; y[c[k].p2] = out[4][k]; z[c[k].p2] = out[5][k];
+		}
+	}
+	float lanes[4] __attribute__((aligned(16)));
+	_mm_store_ps(lanes, violation);
+	for(int k = 0; k < 4; k++)
+		max_violation = fmaxf(max_violation, lanes[k]);
+	return true;
+}
+
+/* ******************************************************************************************** */
+bool computeCorrectionsSSE(const Constraints &constraints, size_t begin, size_t end, const Particles &particles,
+		float stiffness, float *cx, float *cy, float *cz, float &max_violation) {
+	if(begin >= end) return true;
+	const float *x = &particles.x[0], *y = &particles.y[0], *z = &particles.z[0];
+	const ConstraintPair *pairs = &constraints.pairs[0];
+	const float *rest = &constraints.rest_distance[0];
+	const __m128 one = _mm_set1_ps(1.0f), half = _mm_set1_ps(0.5f), three_halves = _mm_set1_ps(1.5f);
+	const __m128 factor = _mm_set1_ps(0.25f * stiffness);
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	__m128 violation = _mm_setzero_ps();
+
+	for(size_t i = begin; i < end; i += 4) {
+		const ConstraintPair *c = pairs + i;
+		__m128 dx = _mm_sub_ps(_mm_setr_ps(x[c[0].p2], x[c[1].p2], x[c[2].p2], x[c[3].p2]),
+				_mm_setr_ps(x[c[0].p1], x[c[1].p1], x[c[2].p1], x[c[3].p1]));
+		__m128 dy = _mm_sub_ps(_mm_setr_ps(y[c[0].p2], y[c[1].p2], y[c[2].p2], y[c[3].p2]),
+				_mm_setr_ps(y[c[0].p1], y[c[1].p1], y[c[2].p1], y[c[3].p1]));
+		__m128 dz = _mm_sub_ps(_mm_setr_ps(z[c[0].p2], z[c[1].p2], z[c[2].p2], z[c[3].p2]),
+				_mm_setr_ps(z[c[0].p1], z[c[1].p1], z[c[2].p1], z[c[3].p1]));
+		__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		__m128 r = _mm_rsqrt_ps(d2);
+		r = _mm_mul_ps(r, _mm_sub_ps(three_halves, _mm_mul_ps(_mm_mul_ps(half, d2), _mm_mul_ps(r, r))));
+		__m128 stretch = _mm_sub_ps(one, _mm_mul_ps(_mm_loadu_ps(rest + i), r));
+		__m128 scale = _mm_mul_ps(stretch, factor);
+		violation = _mm_max_ps(violation, _mm_andnot_ps(sign, stretch));
+		_mm_storeu_ps(cx + i, _mm_mul_ps(dx, scale));
+		_mm_storeu_ps(cy + i, _mm_mul_ps(dy, scale));
+		_mm_storeu_ps(cz + i, _mm_mul_ps(dz, scale));
+	}
+	float lanes[4] __attribute__((aligned(16)));
+	_mm_store_ps(lanes, violation);
+	for(int k = 0; k < 4; k++)
+		max_violation = fmaxf(max_violation, lanes[k]);
+	return true;
+}
+
+#else
+
+/* ******************************************************************************************** */
+bool satisfyBatchesSSE(const Constraints &constraints, size_t begin, size_t end, Particles &particles, float stiffness,
+		float &max_violation) {
+	return false;
+}
+
+/* ******************************************************************************************** */
+bool computeCorrectionsSSE(const Constraints &constraints, size_t begin, size_t end, const Particles &particles,
+		float stiffness, float *cx, float *cy, float *cz, float &max_violation) {
+	return false;
+}
+
+#endif
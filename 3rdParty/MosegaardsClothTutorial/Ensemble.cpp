@@ -0,0 +1,90 @@
+/**
+ * @file Ensemble.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "Ensemble.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+
+/* ******************************************************************************************** */
+size_t Ensemble::add(const EnsembleParams &params, std::shared_ptr <const ClothState> start) {
+
+	// Build the constraints only for the first member of each grid, and restore its rest distances only once
+	std::shared_ptr <const Constraints> &topology = topologies[std::make_tuple(params.width, params.height,
+			params.num_particles_width, params.num_particles_height, start.get())];
+	std::unique_ptr <Cloth> cloth_ptr(new Cloth(params.width, params.height, params.num_particles_width,
+			params.num_particles_height, topology));
+	if(start && !cloth_ptr->setState(*start)) {
+		if(!topology) topologies.erase(std::make_tuple(params.width, params.height, params.num_particles_width,
+				params.num_particles_height, start.get()));
+		return (size_t) -1;
+	}
+	if(start && std::find(starts.begin(), starts.end(), start) == starts.end()) starts.push_back(start);
+	cloths.push_back(std::move(cloth_ptr));
+	Cloth &cloth = *cloths.back();
+	if(!topology) topology = cloth.getTopology();
+	cloth.setStiffness(params.stiffness);
+	cloth.setDamping(params.damping);
+
+	this->params.push_back(params);
+	probes.push_back(CollisionShape::sphere(params.probe_center, params.probe_radius));
+	EnsembleResult result = {0, Vec3(0, 0, 0), 0.0f, 0, 0.0f, 0.0f, 0.0};
+	results.push_back(result);
+	return cloths.size() - 1;
+}
+
+/* ******************************************************************************************** */
+void Ensemble::run(int frames) {
+	std::function <void(size_t, int)> step = [&](size_t m, int) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		Cloth &cloth = *cloths[m];
+		CollisionShape &probe = probes[m];
+		EnsembleResult &result = results[m];
+		for(int i = 0; i < frames; i++) {
+			cloth.timeStep();
+			probe.old_center = probe.center;
+			probe.center = probe.center + params[m].probe_velocity;
+			cloth.collide(&probe, 1);
+		}
+
+		// Summarize the last frame
+		const Particles &particles = cloth.getParticles();
+		result.frames += frames;
+		result.center = particles.getPos(cloth.getParticle(cloth.getNumParticlesWidth() / 2, cloth.getNumParticlesHeight() / 2));
+		result.max_sag = 0.0f;
+		for(size_t p = 0; p < particles.size(); p++)
+			result.max_sag = std::max(result.max_sag, -particles.y[p]);
+		TactileView force = cloth.getTactileView(TactileMap::FORCE);
+		result.total_force = 0.0f;
+		for(int y = 0; y < force.height; y++)
+			for(int x = 0; x < force.width; x++)
+				result.total_force += force.at(x, y);
+		result.contacts = cloth.getTactileMap().numContacts();
+		result.max_violation = cloth.getSolverStats().max_violation;
+		result.seconds += std::chrono::duration <double>(std::chrono::steady_clock::now() - start).count();
+	};
+	if(pool != NULL) pool->runTasks(cloths.size(), step);
+	else for(size_t m = 0; m < cloths.size(); m++)
+		step(m, 0);
+}
+
+/* ******************************************************************************************** */
+void Ensemble::writeResults(FILE *out) const {
+	fprintf(out, "member\tgrid\tsize\tstiffness\tdamping\tprobe_x\tprobe_y\tprobe_z\tradius\tframes\tcenter_x\tcenter_y\t"
+			"center_z\tmax_sag\tcontacts\tforce\tviolation\tseconds\n");
+	for(size_t m = 0; m < cloths.size(); m++) {
+		const EnsembleParams &p = params[m];
+		const EnsembleResult &r = results[m];
+		fprintf(out, "%lu\t%dx%d\t%gx%g\t%g\t%g\t%g\t%g\t%g\t%g\t%d\t%.6f\t%.6f\t%.6f\t%.6f\t%lu\t%g\t%g\t%.4lf\n",
+				(unsigned long) m, p.num_particles_width, p.num_particles_height, p.width, p.height, p.stiffness, p.damping,
+				p.probe_center.f[0], p.probe_center.f[1], p.probe_center.f[2], p.probe_radius, r.frames, r.center.f[0],
+				r.center.f[1], r.center.f[2], r.max_sag, (unsigned long) r.contacts, r.total_force, r.max_violation,
+				r.seconds);
+	}
+}
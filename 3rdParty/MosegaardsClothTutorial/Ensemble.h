@@ -0,0 +1,81 @@
+/**
+ * @file Ensemble.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief Many independent cloths with different parameters, stepped together on the threads of a pool
+ */
+
+#pragma once
+
+#include "Cloth.h"
+#include "ClothState.h"
+
+#include <map>
+#include <memory>
+#include <stdio.h>
+#include <tuple>
+#include <vector>
+
+class ThreadPool;
+
+/* The parameters of a member of an ensemble. The defaults are the scene of the viewer. */
+struct EnsembleParams {
+	float width, height;  // the size of the cloth
+	int num_particles_width, num_particles_height;
+	float stiffness;  // see Cloth::setStiffness()
+	float damping;  // see Cloth::setDamping()
+	Vec3 probe_center;  // the ball pressed into the cloth
+	float probe_radius;
+	Vec3 probe_velocity;  // how far the ball moves each frame
+
+	EnsembleParams() : width(14), height(10), num_particles_width(55), num_particles_height(45), stiffness(1.0f),
+			damping((float) DAMPING), probe_center(7.0, 1.0, -5.0), probe_radius(0.5f), probe_velocity(0, 0, 0) {}
+};
+
+/* What a member ended up with after Ensemble::run() */
+struct EnsembleResult {
+	int frames;  // stepped so far
+	Vec3 center;  // the position of the particle at the center of the grid
+	float max_sag;  // how far the lowest particle is below the plane the cloth started in
+	size_t contacts;  // particles touching the probe in the last frame
+	float total_force;  // the normal force the probe applied in the last frame
+	float max_violation;  // of the constraints in the last frame
+	double seconds;  // spent stepping the member
+};
+
+/* Holds any number of cloths with their own parameters and steps them concurrently, one member per task, on the
+ work-stealing tasks of a ThreadPool so that members of different sizes keep all the threads busy. The cloths are
+ allocated once, when they are added; members with the same grid and size share one copy of the constraints. */
+class Ensemble {
+private:
+	ThreadPool *pool;  // not owned
+	std::vector <EnsembleParams> params;
+	std::vector <std::unique_ptr <Cloth> > cloths;
+	std::vector <CollisionShape> probes;
+	std::vector <EnsembleResult> results;
+	std::map <std::tuple <float, float, int, int, const ClothState *>, std::shared_ptr <const Constraints> > topologies;  // by size, grid and start
+	std::vector <std::shared_ptr <const ClothState> > starts;  // the states the members started from, kept for the topologies
+
+public:
+
+	/* The members are stepped on the threads of the pool, or on the calling thread if it is NULL */
+	explicit Ensemble(ThreadPool *pool) : pool(pool) {}
+
+	/* Creates a cloth with the parameters, returns its index. With a start, the cloth is restored from it (see
+	 Cloth::setState()) instead of starting flat, and all the members started from it share their constraints even if
+	 its rest distances are not those of the flat grid. Returns -1 if the start is not of the grid of the parameters. */
+	size_t add(const EnsembleParams &params, std::shared_ptr <const ClothState> start = std::shared_ptr <const ClothState>());
+
+	size_t size() const { return cloths.size(); }
+	size_t numTopologies() const { return topologies.size(); }
+	Cloth& getCloth(size_t i) { return *cloths[i]; }
+	const EnsembleParams& getParams(size_t i) const { return params[i]; }
+	const EnsembleResult& getResult(size_t i) const { return results[i]; }
+
+	/* Steps every member the given number of frames, moving its probe and colliding the cloth with it as ClothHeadless does */
+	void run(int frames);
+
+	/* Writes a header line and then the parameters and the result of each member, in the order they were added, as
+	 tab separated columns */
+	void writeResults(FILE *out) const;
+};
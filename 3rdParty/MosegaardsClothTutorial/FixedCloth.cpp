@@ -0,0 +1,28 @@
+/**
+ * @file FixedCloth.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "FixedCloth.h"
+
+/* The grids with a specialization, as (width, height) */
+#define FIXED_CLOTH_GRIDS(GRID) GRID(55, 45) GRID(17, 17) GRID(16, 16) GRID(32, 32) GRID(64, 64)
+
+/* ******************************************************************************************** */
+bool hasFixedCloth(int num_particles_width, int num_particles_height) {
+#define HAS_GRID(W, H) if(num_particles_width == W && num_particles_height == H) return true;
+	FIXED_CLOTH_GRIDS(HAS_GRID)
+#undef HAS_GRID
+	return false;
+}
+
+/* ******************************************************************************************** */
+std::unique_ptr <Cloth> makeCloth(float width, float height, int num_particles_width, int num_particles_height) {
+#define MAKE_GRID(W, H) if(num_particles_width == W && num_particles_height == H) \
+		return std::unique_ptr <Cloth>(new FixedCloth <W, H, CONSTRAINT_ITERATIONS>(width, height));
+	FIXED_CLOTH_GRIDS(MAKE_GRID)
+#undef MAKE_GRID
+	return std::unique_ptr <Cloth>(new Cloth(width, height, num_particles_width, num_particles_height));
+}
@@ -0,0 +1,135 @@
+/**
+ * @file FixedCloth.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief A cloth whose grid size and number of iterations are known at compile time
+ */
+
+#pragma once
+
+#include "Cloth.h"
+
+#include <memory>
+
+/* A Cloth of W x H particles that satisfies its constraints with loops specialized for the grid. The constraints of
+ the grid are not read from the table but walked by their direction, with the neighbor offsets and the loop bounds as
+ constants, and the rest distance is the same for all the constraints of a direction, so the loops have no index loads
+ or boundary checks and can be unrolled and vectorized. Within a row the constraints to the next rows share no
+ particles, so their loops vectorize without changing the result; the constraints along a row are done in passes over
+ every 2 * DX'th column for the same reason.
+
+ The constraints are satisfied direction by direction, row by row, instead of in the batched order of Cloth, so the
+ result differs from it in the rounding but not in the physics. Each time step runs Iter iterations, stopping early at
+ the tolerance; setMaxIterations() has no effect on it. The specialized loops are only used by the serial Gauss-Seidel
+ solver, with a thread pool or the Jacobi solver this is a plain Cloth, and so it is after setState() with a state
+ whose rest distances are not those of the grid. */
+template <int W, int H, int Iter>
+class FixedCloth : public Cloth {
+private:
+	static_assert(W >= 3 && H >= 3 && Iter >= 1, "the grid needs 3 particles across and the solver an iteration");
+
+	/* The directions of the constraints that the Cloth constructor creates, from (x, y) to (x + dx, y + dy) */
+	enum Direction { RIGHT, DOWN, DOWN_RIGHT, DOWN_LEFT, RIGHT2, DOWN2, DOWN_RIGHT2, DOWN_LEFT2, NUM_DIRECTIONS };
+
+	float rest_distance[NUM_DIRECTIONS];
+	uint64_t grid_hash;  // the topologyHash() of the constraints of the grid
+	bool specialized;  // false once restored from a state with other rest distances, then Cloth satisfies them
+
+	/* Satisfies the constraints from (x, y) to (x + DX, y + DY) in the row y, for x from x_begin up to X_END in steps of
+	 X_STEP. Returns the largest violation. */
+	template <int DX, int DY, int X_END, int X_STEP>
+	static float satisfyRow(int y, int x_begin, float rest, float stiffness, float * __restrict px,
+			float * __restrict py, float * __restrict pz, const float * __restrict inv_mass) {
+		constexpr int offset = DY * W + DX;
+		const float scale_factor = 0.25f * stiffness;
+		float max_violation = 0.0f;
+		const int row = y * W;
+		for(int i = row + x_begin; i < row + X_END; i += X_STEP) {
+			float dx = px[i + offset] - px[i], dy = py[i + offset] - py[i], dz = pz[i + offset] - pz[i];
+			float stretch = 1.0f - rest / sqrtf(dx * dx + dy * dy + dz * dz);
+			float scale = stretch * scale_factor;
+			float w1 = inv_mass[i], w2 = inv_mass[i + offset];
+			px[i] += dx * scale * w1; py[i] += dy * scale * w1; pz[i] += dz * scale * w1;
+			px[i + offset] -= dx * scale * w2; py[i + offset] -= dy * scale * w2; pz[i + offset] -= dz * scale * w2;
+			float violation = fabsf(stretch);
+			max_violation = (violation > max_violation) ? violation : max_violation;
+		}
+		return max_violation;
+	}
+
+	/* Satisfies all the constraints of a direction */
+	template <int DX, int DY>
+	float satisfyDirection(Direction direction, float stiffness, Particles &particles) const {
+		constexpr int x_begin = (DX < 0) ? -DX : 0, x_end = (DX > 0) ? W - DX : W;
+		float *x = &particles.x[0], *y = &particles.y[0], *z = &particles.z[0];
+		const float *inv_mass = &particles.inv_mass[0];
+		const float rest = rest_distance[direction];
+		float max_violation = 0.0f;
+		for(int row = 0; row < H - DY; row++) {
+			if(DY == 0) {
+
+				// The constraints along a row form chains, the links 2 * DX columns apart share no particles
+				for(int block = 0; block < 2 * DX; block++)
+					max_violation = fmaxf(max_violation, satisfyRow <DX, DY, x_end, 2 * DX>(row, (block % 2) * DX + block / 2,
+							rest, stiffness, x, y, z, inv_mass));
+			}
+			else max_violation = fmaxf(max_violation, satisfyRow <DX, DY, x_end, 1>(row, x_begin, rest, stiffness, x, y, z,
+					inv_mass));
+		}
+		return max_violation;
+	}
+
+protected:
+
+	SolverStats satisfyConstraintsSerial() {
+		if(!specialized) return Cloth::satisfyConstraintsSerial();
+		Particles &particles = getParticles();
+		const float stiffness = getStiffness(), tolerance = getTolerance();
+		SolverStats stats = {0, 0.0f};
+		for(int i = 0; i < Iter; i++) {
+			float violation = satisfyDirection <1, 0>(RIGHT, stiffness, particles);
+			violation = fmaxf(violation, satisfyDirection <0, 1>(DOWN, stiffness, particles));
+			violation = fmaxf(violation, satisfyDirection <1, 1>(DOWN_RIGHT, stiffness, particles));
+			violation = fmaxf(violation, satisfyDirection <-1, 1>(DOWN_LEFT, stiffness, particles));
+			violation = fmaxf(violation, satisfyDirection <2, 0>(RIGHT2, stiffness, particles));
+			violation = fmaxf(violation, satisfyDirection <0, 2>(DOWN2, stiffness, particles));
+			violation = fmaxf(violation, satisfyDirection <2, 2>(DOWN_RIGHT2, stiffness, particles));
+			violation = fmaxf(violation, satisfyDirection <-2, 2>(DOWN_LEFT2, stiffness, particles));
+			stats.iterations = i + 1;
+			stats.max_violation = violation;
+			if(violation < tolerance) break;
+		}
+		return stats;
+	}
+
+public:
+
+	static constexpr int num_particles_width = W, num_particles_height = H, iterations = Iter;
+
+	FixedCloth(float width, float height) : Cloth(width, height, W, H) {
+		setMaxIterations(Iter);
+
+		// The particles start on a regular grid, so every constraint of a direction has the same rest distance
+		const Particles &particles = getParticles();
+		const int dx[NUM_DIRECTIONS] = {1, 0, 1, -1, 2, 0, 2, -2}, dy[NUM_DIRECTIONS] = {0, 1, 1, 1, 0, 2, 2, 2};
+		for(int d = 0; d < NUM_DIRECTIONS; d++) {
+			int p1 = getParticle(2, 0), p2 = getParticle(2 + dx[d], dy[d]);
+			rest_distance[d] = (particles.getPos(p2) - particles.getPos(p1)).length();
+		}
+		grid_hash = getConstraints().topologyHash();
+		specialized = true;
+	}
+
+	bool setState(const ClothState &state) {
+		if(!Cloth::setState(state)) return false;
+		specialized = (getConstraints().topologyHash() == grid_hash);
+		return true;
+	}
+};
+
+/* Whether makeCloth() has a FixedCloth for the grid */
+bool hasFixedCloth(int num_particles_width, int num_particles_height);
+
+/* Creates a FixedCloth with CONSTRAINT_ITERATIONS iterations if one was compiled for the grid (the viewer's 55x45,
+ matlab/deneme.m's 17x17 and the square sensor grids of 16, 32 and 64 particles), otherwise a Cloth */
+std::unique_ptr <Cloth> makeCloth(float width, float height, int num_particles_width, int num_particles_height);
@@ -0,0 +1,175 @@
+/**
+ * @file MassSpring.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "MassSpring.h"
+
+#include <Eigen/LU>
+
+/* ******************************************************************************************** */
+MassSpringIntegrator::MassSpringIntegrator(const Cloth &cloth, const MassSpringParams &params) : params(params),
+		cg_iterations(0), cg_residual(0.0f) {
+	const Constraints &constraints = cloth.getConstraints();
+	const Particles &particles = cloth.getParticles();
+	springs = constraints.pairs;
+	rest_distance = constraints.rest_distance;
+
+	// The pattern of the matrix is that of the springs, and does not change from step to step
+	std::vector <std::pair <uint32_t, uint32_t> > pairs(springs.size());
+	for(size_t s = 0; s < springs.size(); s++)
+		pairs[s] = std::make_pair(springs[s].p1, springs[s].p2);
+	size_t n = particles.size();
+	system.buildPattern(n, pairs);
+	spring_blocks.resize(4 * springs.size());
+	for(size_t s = 0; s < springs.size(); s++) {
+		uint32_t p1 = springs[s].p1, p2 = springs[s].p2;
+		spring_blocks[4 * s + 0] = system.diagonal[p1];
+		spring_blocks[4 * s + 1] = system.find(p1, p2);
+		spring_blocks[4 * s + 2] = system.find(p2, p1);
+		spring_blocks[4 * s + 3] = system.diagonal[p2];
+	}
+
+	movable.resize(n);
+	for(size_t i = 0; i < n; i++)
+		movable[i] = particles.isMovable(i) ? 1.0f : 0.0f;
+	BlockVector *vectors[] = {&velocity, &force, &rhs, &dv, &residual, &direction, &product, &preconditioned};
+	for(int v = 0; v < 8; v++)
+		vectors[v]->assign(n, Eigen::Vector3f::Zero());
+	inverse_diagonal.resize(n);
+}
+
+/* ******************************************************************************************** */
+void MassSpringIntegrator::computeForces(const Cloth &cloth, bool jacobian) {
+	const Particles &particles = cloth.getParticles();
+	const float h = params.time_step;
+	const Eigen::Vector3f gravity(params.gravity.f[0], params.gravity.f[1], params.gravity.f[2]);
+
+	// The velocities of the last step, and the forces on each particle alone
+	for(size_t i = 0; i < particles.size(); i++) {
+		velocity[i] = Eigen::Vector3f(particles.x[i] - particles.old_x[i], particles.y[i] - particles.old_y[i],
+				particles.z[i] - particles.old_z[i]) * (movable[i] / h);
+		Eigen::Vector3f acceleration(particles.acc_x[i], particles.acc_y[i], particles.acc_z[i]);
+		force[i] = (gravity + acceleration) * params.mass - params.damping * velocity[i];
+	}
+	if(jacobian) {
+		system.setZero();
+		float diagonal = params.mass + h * params.damping;
+		for(size_t i = 0; i < particles.size(); i++)
+			system.blocks[system.diagonal[i]].diagonal().setConstant(diagonal);
+	}
+
+	// The springs: f1 = k (l - L) d / l with d = x2 - x1, and f2 = -f1
+	for(size_t s = 0; s < springs.size(); s++) {
+		uint32_t p1 = springs[s].p1, p2 = springs[s].p2;
+		Eigen::Vector3f d(particles.x[p2] - particles.x[p1], particles.y[p2] - particles.y[p1],
+				particles.z[p2] - particles.z[p1]);
+		float length = d.norm();
+		Eigen::Vector3f direction = d / length;
+		Eigen::Vector3f f = params.stiffness * (length - rest_distance[s]) * direction;
+		force[p1] += f;
+		force[p2] -= f;
+		if(!jacobian) continue;
+
+		// df1/dx2 = k (d d^T + max(1 - L / l, 0) (I - d d^T)), clamped so that compressed springs keep the matrix
+		// positive definite
+		Eigen::Matrix3f outer = direction * direction.transpose();
+		float stretch = std::max(1.0f - rest_distance[s] / length, 0.0f);
+		Eigen::Matrix3f k = params.stiffness * (outer + stretch * (Eigen::Matrix3f::Identity() - outer));
+
+		// The system is M + h c I - h^2 df/dx, and the right hand side gets h df/dx v
+		Eigen::Matrix3f hk = (h * h) * k;
+		const uint32_t *block = &spring_blocks[4 * s];
+		system.blocks[block[0]] += hk;
+		system.blocks[block[1]] -= hk;
+		system.blocks[block[2]] -= hk;
+		system.blocks[block[3]] += hk;
+		Eigen::Vector3f dfv = h * (k * (velocity[p2] - velocity[p1]));
+		force[p1] += dfv;
+		force[p2] -= dfv;
+	}
+}
+
+/* ******************************************************************************************** */
+int MassSpringIntegrator::solve() {
+	const size_t n = rhs.size();
+	for(size_t i = 0; i < n; i++)
+		inverse_diagonal[i] = system.blocks[system.diagonal[i]].inverse() * movable[i];
+
+	// Preconditioned conjugate gradient from dv = 0, filtered so that the pinned particles never move
+	float rhs_norm = 0.0f, rz = 0.0f;
+	for(size_t i = 0; i < n; i++) {
+		dv[i].setZero();
+		residual[i] = rhs[i] * movable[i];
+		direction[i] = preconditioned[i] = inverse_diagonal[i] * residual[i];
+		rhs_norm += residual[i].squaredNorm();
+		rz += residual[i].dot(preconditioned[i]);
+	}
+	float threshold = params.cg_tolerance * params.cg_tolerance * rhs_norm;
+	float residual_norm = rhs_norm;
+	int iteration = 0;
+	while(iteration < params.cg_max_iterations && residual_norm > threshold) {
+		iteration++;
+		system.multiply(direction, product);
+		float dap = 0.0f;
+		for(size_t i = 0; i < n; i++) {
+			product[i] *= movable[i];
+			dap += direction[i].dot(product[i]);
+		}
+		float alpha = rz / dap;
+		float rz_next = 0.0f;
+		residual_norm = 0.0f;
+		for(size_t i = 0; i < n; i++) {
+			dv[i] += alpha * direction[i];
+			residual[i] -= alpha * product[i];
+			preconditioned[i] = inverse_diagonal[i] * residual[i];
+			rz_next += residual[i].dot(preconditioned[i]);
+			residual_norm += residual[i].squaredNorm();
+		}
+		float beta = rz_next / rz;
+		rz = rz_next;
+		for(size_t i = 0; i < n; i++)
+			direction[i] = preconditioned[i] + beta * direction[i];
+	}
+	cg_residual = (rhs_norm > 0.0f) ? sqrtf(residual_norm / rhs_norm) : 0.0f;
+	return iteration;
+}
+
+/* ******************************************************************************************** */
+void MassSpringIntegrator::applyVelocities(Cloth &cloth) {
+	Particles &particles = cloth.getParticles();
+	const float h = params.time_step;
+	for(size_t i = 0; i < particles.size(); i++) {
+		if(movable[i] == 0.0f) continue;
+		particles.old_x[i] = particles.x[i];
+		particles.old_y[i] = particles.y[i];
+		particles.old_z[i] = particles.z[i];
+		particles.x[i] += h * velocity[i].x();
+		particles.y[i] += h * velocity[i].y();
+		particles.z[i] += h * velocity[i].z();
+		particles.acc_x[i] = particles.acc_y[i] = particles.acc_z[i] = 0.0f;  // used up in this step
+	}
+}
+
+/* ******************************************************************************************** */
+void MassSpringIntegrator::stepImplicit(Cloth &cloth) {
+	computeForces(cloth, true);
+	for(size_t i = 0; i < rhs.size(); i++)
+		rhs[i] = params.time_step * force[i];
+	cg_iterations = solve();
+	for(size_t i = 0; i < velocity.size(); i++)
+		velocity[i] += dv[i];
+	applyVelocities(cloth);
+}
+
+/* ******************************************************************************************** */
+void MassSpringIntegrator::stepExplicit(Cloth &cloth) {
+	computeForces(cloth, false);
+	for(size_t i = 0; i < velocity.size(); i++)
+		velocity[i] += force[i] * (movable[i] * params.time_step / params.mass);
+	applyVelocities(cloth);
+	cg_iterations = 0;
+	cg_residual = 0.0f;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file MassSpring.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief The cloth as a mass-spring system, integrated with large implicit (backward Euler) steps
+ *
+ * This is the model of matlab/deneme.m over the constraints of a Cloth: every constraint is a spring of its rest
+ * distance, every particle has the same mass, and there is gravity and viscous damping. Instead of the explicit
+ * Euler steps of the prototype, which have to be short for stiff springs to stay stable, a step solves
+ *
+ *   (M + h c I - h^2 df/dx) dv = h (f + h df/dx v)
+ *
+ * for the change of the velocities with a block-Jacobi preconditioned conjugate gradient, over a block sparse
+ * matrix whose pattern is built once.
+ */
+
+#pragma once
+
+#include "BlockSparseMatrix.h"
+#include "Cloth.h"
+
+/* The constants of the model, the defaults are those of matlab/deneme.m */
+struct MassSpringParams {
+	float stiffness;  // k of the springs
+	float damping;  // the viscous damping coefficient
+	float mass;  // of each particle
+	Vec3 gravity;
+	float time_step;  // h, in seconds
+	float cg_tolerance;  // the conjugate gradient stops once the residual is this small relative to the right hand side
+	int cg_max_iterations;
+
+	MassSpringParams() : stiffness(100.0f), damping(0.5f), mass(10.0f), gravity(0.0, -9.81, 0.0), time_step(0.05f),
+			cg_tolerance(1e-4f), cg_max_iterations(200) {}
+};
+
+/* Integrates the particles of a cloth as masses connected by its constraints as springs. The velocities are taken from
+ the positions and the old positions of the particles, so the collisions of the cloth (which move the positions) and
+ the accelerations added with Cloth::addForce() are accounted for. The unmovable particles stay in place. */
+class MassSpringIntegrator {
+private:
+	MassSpringParams params;
+	std::vector <ConstraintPair> springs;  // a copy, so that the cloth can still reorder its constraints
+	std::vector <float> rest_distance;
+	std::vector <uint32_t> spring_blocks;  // the blocks (p1, p1), (p1, p2), (p2, p1) and (p2, p2) of each spring
+	std::vector <float> movable;  // 1 for the particles that move, 0 for the pinned ones
+	BlockSparseMatrix system;  // the matrix of the implicit step
+	BlockVector velocity, force, rhs, dv, residual, direction, product, preconditioned;
+	std::vector <Eigen::Matrix3f> inverse_diagonal;  // the block-Jacobi preconditioner
+	int cg_iterations;  // of the last implicit step
+	float cg_residual;  // relative, after the last implicit step
+
+	/* Reads the velocities from the cloth and computes the forces. With jacobian, also fills the matrix of the implicit
+	 step and adds h df/dx v to the forces. */
+	void computeForces(const Cloth &cloth, bool jacobian);
+
+	/* Moves the particles of the cloth with the velocities */
+	void applyVelocities(Cloth &cloth);
+
+	/* Solves the system for dv, returns the number of iterations */
+	int solve();
+
+public:
+
+	MassSpringIntegrator(const Cloth &cloth, const MassSpringParams &params = MassSpringParams());
+
+	const MassSpringParams& getParams() const { return params; }
+	void setParams(const MassSpringParams &params) { this->params = params; }
+
+	/* One backward Euler step of params.time_step, stable for any stiffness */
+	void stepImplicit(Cloth &cloth);
+
+	/* One semi-implicit (symplectic) Euler step of params.time_step as in matlab/deneme.m, for comparison. It is only
+	 stable for time steps below about 2 sqrt(mass / (stiffness * springs per particle)). */
+	void stepExplicit(Cloth &cloth);
+
+	int getCGIterations() const { return cg_iterations; }
+	float getCGResidual() const { return cg_residual; }
+};
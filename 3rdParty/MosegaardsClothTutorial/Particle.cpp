@@ -0,0 +1,40 @@
+/**
+ * @file Particle.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "Particle.h"
+
+#include <algorithm>
+
+/* ******************************************************************************************** */
+void Particles::resetNormals() {
+	std::fill(normal_x.begin(), normal_x.end(), 0.0f);
+	std::fill(normal_y.begin(), normal_y.end(), 0.0f);
+	std::fill(normal_z.begin(), normal_z.end(), 0.0f);
+}
+
+/* ******************************************************************************************** */
+void Particles::timeStep(float damping, size_t begin, size_t end) {
+	const float kept = 1.0f - damping;
+	const float time_step2 = (float) (TIME_STEPSIZE2);
+	float *px = &x[0], *py = &y[0], *pz = &z[0];
+	float *ox = &old_x[0], *oy = &old_y[0], *oz = &old_z[0];
+	float *ax = &acc_x[0], *ay = &acc_y[0], *az = &acc_z[0];
+	const float *w = &inv_mass[0];
+	for(size_t i = begin; i < end; i++) {
+
+		// The pinned particles are masked out rather than skipped, which keeps the loop free of branches
+		float moving = (w[i] != 0.0f) ? 1.0f : 0.0f;
+		float tx = px[i], ty = py[i], tz = pz[i];
+		px[i] = tx + (tx - ox[i]) * kept * moving + ax[i] * time_step2 * moving;
+		py[i] = ty + (ty - oy[i]) * kept * moving + ay[i] * time_step2 * moving;
+		pz[i] = tz + (tz - oz[i]) * kept * moving + az[i] * time_step2 * moving;
+		ox[i] = tx;
+		oy[i] = ty;
+		oz[i] = tz;
+		ax[i] = ay[i] = az[i] = 0.0f; // acceleration is reset since it HAS been translated into a change in position (and implicitely into velocity)
+	}
+}
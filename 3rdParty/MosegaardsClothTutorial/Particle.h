@@ -9,63 +9,89 @@
 
 #include "Vec3.h"
 
+#include <stddef.h>
+#include <vector>
+
 /* Some physics constants */
 #define DAMPING 0.01 // how much to damp the cloth simulation each frame
 #define TIME_STEPSIZE2 0.5*0.5 // how large time step each particle takes each frame
 #define CONSTRAINT_ITERATIONS 15 // how many iterations of constraint satisfaction each frame (more is rigid, less is soft)
 
-/* The particle class represents a particle of mass that can move around in 3D space*/
-class Particle
+/* The particles of mass that can move around in 3D space. They are stored as a structure of arrays,
+ one contiguous array per component, so that the constraint solver only pulls in the positions and
+ inverse masses it touches. A particle is pinned by setting its inverse mass to 0. */
+class Particles
 {
-private:
-	bool movable; // can the particle move or not ? used to pin parts of the cloth
-
-	float mass; // the mass of the particle (is always 1 in this example)
-	Vec3 pos; // the current position of the particle in 3D space
-	Vec3 old_pos; // the position of the particle in the previous time step, used as part of the verlet numerical integration scheme
-	Vec3 acceleration; // a vector representing the current acceleration of the particle
-	Vec3 accumulated_normal; // an accumulated normal (i.e. non normalized), used for OpenGL soft shading
-
 public:
-	Particle(Vec3 pos) : pos(pos), old_pos(pos),acceleration(Vec3(0,0,0)), mass(1), movable(true), accumulated_normal(Vec3(0,0,0)){}
-	Particle(){}
+	std::vector <float> x, y, z; // the current positions of the particles in 3D space
+	std::vector <float> old_x, old_y, old_z; // the positions in the previous time step, used as part of the verlet numerical integration scheme
+	std::vector <float> acc_x, acc_y, acc_z; // the current accelerations of the particles
+	std::vector <float> inv_mass; // 1/mass (mass is always 1 in this example), 0 for the unmovable particles
+	std::vector <float> normal_x, normal_y, normal_z; // accumulated normals (i.e. non normalized), used for OpenGL soft shading
+
+	size_t size() const { return x.size(); }
 
-	void addForce(Vec3 f)
+	/* Resizes all the arrays, the new particles are at the origin with unit mass */
+	void resize(size_t n)
 	{
-		acceleration += f/mass;
+		x.resize(n, 0.0f); y.resize(n, 0.0f); z.resize(n, 0.0f);
+		old_x.resize(n, 0.0f); old_y.resize(n, 0.0f); old_z.resize(n, 0.0f);
+		acc_x.resize(n, 0.0f); acc_y.resize(n, 0.0f); acc_z.resize(n, 0.0f);
+		inv_mass.resize(n, 1.0f);
+		normal_x.resize(n, 0.0f); normal_y.resize(n, 0.0f); normal_z.resize(n, 0.0f);
 	}
 
-	/* This is one of the important methods, where the time is progressed a single step size (TIME_STEPSIZE)
-	   The method is called by Cloth.time_step()
-	   Given the equation "force = mass * acceleration" the next position is found through verlet integration*/
-	void timeStep()
+	/* Places the particle at rest at the given position */
+	void setPos(size_t i, const Vec3 &pos)
 	{
-		if(movable)
-		{
-			Vec3 temp = pos;
-			pos = pos + (pos-old_pos)*(1.0-DAMPING) + acceleration*TIME_STEPSIZE2;
-			old_pos = temp;
-			acceleration = Vec3(0,0,0); // acceleration is reset since it HAS been translated into a change in position (and implicitely into velocity)
-		}
+		x[i] = old_x[i] = pos.f[0];
+		y[i] = old_y[i] = pos.f[1];
+		z[i] = old_z[i] = pos.f[2];
 	}
 
-	Vec3& getPos() {return pos;}
-
-	void resetAcceleration() {acceleration = Vec3(0,0,0);}
+	Vec3 getPos(size_t i) const { return Vec3(x[i], y[i], z[i]); }
 
-	void offsetPos(const Vec3 v) { if(movable) pos += v;}
+	Vec3 getOldPos(size_t i) const { return Vec3(old_x[i], old_y[i], old_z[i]); }
 
-	void makeUnmovable() {movable = false;}
+	void addForce(size_t i, const Vec3 &f)
+	{
+		acc_x[i] += f.f[0] * inv_mass[i];
+		acc_y[i] += f.f[1] * inv_mass[i];
+		acc_z[i] += f.f[2] * inv_mass[i];
+	}
 
-	void addToNormal(Vec3 normal)
+	/* Moves the particle by v, unmovable particles are left in place */
+	void offsetPos(size_t i, const Vec3 &v)
 	{
-		accumulated_normal += normal.normalized();
+		if(inv_mass[i] == 0.0f) return;
+		x[i] += v.f[0];
+		y[i] += v.f[1];
+		z[i] += v.f[2];
 	}
 
-	Vec3& getNormal() { return accumulated_normal;} // notice, the normal is not unit length
+	void makeUnmovable(size_t i) { inv_mass[i] = 0.0f; }
 
-	void resetNormal() {accumulated_normal = Vec3(0,0,0);}
+	bool isMovable(size_t i) const { return inv_mass[i] != 0.0f; }
 
-};
+	void addToNormal(size_t i, Vec3 normal)
+	{
+		Vec3 n = normal.normalized();
+		normal_x[i] += n.f[0];
+		normal_y[i] += n.f[1];
+		normal_z[i] += n.f[2];
+	}
 
+	Vec3 getNormal(size_t i) const { return Vec3(normal_x[i], normal_y[i], normal_z[i]); } // notice, the normal is not unit length
 
+	void resetNormals();
+
+	/* This is one of the important methods, where the time is progressed a single step size (TIME_STEPSIZE)
+	   for all the particles. The method is called by Cloth.time_step()
+	   Given the equation "force = mass * acceleration" the next position is found through verlet integration.
+	   Unmovable particles stay where they are, even if they were pinned while moving, and their old_pos is set to it.
+	   The damping is the fraction of the velocity lost in each step, DAMPING for the original cloth. */
+	void timeStep(float damping) { timeStep(damping, 0, size()); }
+
+	/* Steps only the particles [begin, end) */
+	void timeStep(float damping, size_t begin, size_t end);
+};
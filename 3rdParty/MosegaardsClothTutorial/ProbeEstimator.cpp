@@ -0,0 +1,182 @@
+/**
+ * @file ProbeEstimator.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "ProbeEstimator.h"
+
+#include "ThreadPool.h"
+
+#include <Eigen/Cholesky>
+#include <algorithm>
+#include <chrono>
+
+/* ******************************************************************************************** */
+ProbeEstimator::ProbeEstimator(const EnsembleParams &cloth_params, const ProbeEstimatorParams &params, ThreadPool *pool) :
+		pool(pool), cloth_params(cloth_params), params(params) {
+
+	// A batch holds the finite differences and the current probe, or the dampings; all the cloths share the constraints
+	size_t num_cloths = (NUM_DAMPINGS > 5) ? NUM_DAMPINGS : 5;
+	std::shared_ptr <const Constraints> topology;
+	for(size_t c = 0; c < num_cloths; c++) {
+		cloths.push_back(std::unique_ptr <Cloth>(new Cloth(cloth_params.width, cloth_params.height,
+				cloth_params.num_particles_width, cloth_params.num_particles_height, topology)));
+		cloths.back()->setStiffness(cloth_params.stiffness);
+		cloths.back()->setDamping(cloth_params.damping);
+		topology = cloths.back()->getTopology();
+	}
+	candidates.resize(num_cloths);
+	errors.resize(num_cloths);
+
+	std::shared_ptr <ClothState> flat = std::make_shared <ClothState>();
+	cloths[0]->getState(*flat);
+	start = flat;
+}
+
+/* ******************************************************************************************** */
+bool ProbeEstimator::setStart(std::shared_ptr <const ClothState> start) {
+	for(size_t c = 0; c < cloths.size(); c++)
+		if(!cloths[c]->setState(*start)) return false;
+	this->start = start;
+	return true;
+}
+
+/* ******************************************************************************************** */
+void ProbeEstimator::rollout(size_t c) {
+	Cloth &cloth = *cloths[c];
+	cloth.setState(*start);
+	const Eigen::Vector4d &probe = candidates[c];
+	CollisionShape shape = CollisionShape::sphere(Vec3(probe[0], probe[1], probe[2]), probe[3]);
+	for(int i = 0; i < params.frames; i++) {
+		cloth.timeStep();
+		cloth.collide(&shape, 1);
+	}
+}
+
+/* ******************************************************************************************** */
+void ProbeEstimator::runBatch(size_t num_candidates, const std::vector <Vec3> &observed) {
+	std::function <void(size_t, int)> task = [&](size_t c, int) {
+		rollout(c);
+		const Particles &particles = cloths[c]->getParticles();
+		double error = 0.0;
+		for(size_t p = 0; p < particles.size(); p++) {
+			float dx = particles.x[p] - observed[p].f[0], dy = particles.y[p] - observed[p].f[1],
+					dz = particles.z[p] - observed[p].f[2];
+			error += dx * dx + dy * dy + dz * dz;
+		}
+		errors[c] = error;
+	};
+	if(pool != NULL) pool->runTasks(num_candidates, task);
+	else for(size_t c = 0; c < num_candidates; c++)
+		task(c, 0);
+}
+
+/* ******************************************************************************************** */
+void ProbeEstimator::simulate(const Vec3 &center, float radius, std::vector <Vec3> &positions) {
+	candidates[0] = Eigen::Vector4d(center.f[0], center.f[1], center.f[2], radius);
+	rollout(0);
+	const Particles &particles = cloths[0]->getParticles();
+	positions.resize(particles.size());
+	for(size_t p = 0; p < particles.size(); p++)
+		positions[p] = particles.getPos(p);
+}
+
+/* ******************************************************************************************** */
+bool ProbeEstimator::estimate(const std::vector <Vec3> &observed, const Vec3 &center, float radius,
+		ProbeEstimate &estimate) {
+	const Particles &fit = cloths[0]->getParticles();
+	if(observed.size() != fit.size()) return false;
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+	Eigen::Vector4d probe(center.f[0], center.f[1], center.f[2], radius);
+	double fit_error = 0.0;
+	double damping = params.damping;
+	const double h = params.difference;
+	Eigen::Matrix4d jtj;  // J^T J and J^T r of the residuals r of the particles at the current probe
+	Eigen::Vector4d jtr;
+	bool have_fit = false, have_jacobian = false;
+	estimate.iterations = 0;
+	estimate.rollouts = 0;
+	for(int it = 0; it < params.max_iterations; it++) {
+
+		// The finite differences of the current probe, and the probe itself on the first iteration
+		if(!have_jacobian) {
+			for(int k = 0; k < 4; k++)
+				candidates[k] = probe + h * Eigen::Vector4d::Unit(k);
+			if(!have_fit) candidates[4] = probe;
+			runBatch(have_fit ? 4 : 5, observed);
+			estimate.rollouts += have_fit ? 4 : 5;
+			if(!have_fit) {
+				const Particles &particles = cloths[4]->getParticles();
+				fit_x = particles.x;
+				fit_y = particles.y;
+				fit_z = particles.z;
+				fit_error = errors[4];
+				have_fit = true;
+			}
+
+			// Accumulate the normal equations one particle at a time, in the order of the particles
+			jtj.setZero();
+			jtr.setZero();
+			const std::vector <float> *fit_axes[3] = {&fit_x, &fit_y, &fit_z};
+			for(int axis = 0; axis < 3; axis++) {
+				const std::vector <float> &current = *fit_axes[axis];
+				const std::vector <float> *moved[4];
+				for(int k = 0; k < 4; k++) {
+					const Particles &particles = cloths[k]->getParticles();
+					moved[k] = (axis == 0) ? &particles.x : (axis == 1) ? &particles.y : &particles.z;
+				}
+				for(size_t p = 0; p < current.size(); p++) {
+					Eigen::Vector4d row;
+					for(int k = 0; k < 4; k++)
+						row[k] = ((*moved[k])[p] - current[p]) / h;
+					jtj.noalias() += row * row.transpose();
+					jtr += row * (current[p] - observed[p].f[axis]);
+				}
+			}
+			have_jacobian = true;
+			if(jtj.trace() == 0.0) break;  // the probe does not touch the cloth
+		}
+
+		// Try the steps of a few dampings at once, 10 times apart around the current one
+		double dampings[NUM_DAMPINGS];
+		for(int j = 0; j < NUM_DAMPINGS; j++) {
+			dampings[j] = damping * pow(10.0, j - 1);
+			Eigen::Matrix4d system = jtj;
+			for(int k = 0; k < 4; k++)
+				system(k, k) += dampings[j] * std::max(jtj(k, k), 1e-9 * jtj.trace());
+			candidates[j] = probe - system.ldlt().solve(jtr);
+			candidates[j][3] = std::max(candidates[j][3], h);  // the radius stays positive
+		}
+		runBatch(NUM_DAMPINGS, observed);
+		estimate.rollouts += NUM_DAMPINGS;
+		estimate.iterations++;
+
+		// Keep the best step if it improves the fit, or damp more and try again from the same Jacobian
+		int best = (int) (std::min_element(errors.begin(), errors.begin() + NUM_DAMPINGS) - errors.begin());
+		double step = (candidates[best] - probe).cwiseAbs().maxCoeff();
+		if(errors[best] < fit_error) {
+			probe = candidates[best];
+			fit_error = errors[best];
+			const Particles &particles = cloths[best]->getParticles();
+			fit_x = particles.x;
+			fit_y = particles.y;
+			fit_z = particles.z;
+			damping = dampings[best];
+			have_jacobian = false;
+			if(step < params.tolerance) break;
+		}
+		else {
+			if((candidates[NUM_DAMPINGS - 1] - probe).cwiseAbs().maxCoeff() < params.tolerance) break;
+			damping = dampings[NUM_DAMPINGS - 1] * 10.0;
+		}
+	}
+
+	estimate.center = Vec3(probe[0], probe[1], probe[2]);
+	estimate.radius = probe[3];
+	estimate.error = sqrt(fit_error / fit.size());
+	estimate.seconds = std::chrono::duration <double>(std::chrono::steady_clock::now() - start_time).count();
+	return true;
+}
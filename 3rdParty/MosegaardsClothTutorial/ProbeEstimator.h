@@ -0,0 +1,84 @@
+/**
+ * @file ProbeEstimator.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief Recovers the ball pressed into the cloth from the observed shape of the cloth, by fitting simulated rollouts
+ */
+
+#pragma once
+
+#include "Ensemble.h"
+
+#include <Eigen/Core>
+
+/* The settings of the fit */
+struct ProbeEstimatorParams {
+	int frames;  // each candidate probe is held in the cloth for this many frames from the start
+	int max_iterations;  // of Levenberg-Marquardt
+	float difference;  // the step of the finite differences of the probe, in the units of the cloth
+	float tolerance;  // the fit stops once a step moves the probe by less than this
+	float damping;  // the first damping of Levenberg-Marquardt, relative to the diagonal of J^T J
+
+	ProbeEstimatorParams() : frames(30), max_iterations(20), difference(0.01f), tolerance(1e-3f), damping(1e-2f) {}
+};
+
+/* The probe found by ProbeEstimator::estimate() */
+struct ProbeEstimate {
+	Vec3 center;
+	float radius;
+	float error;  // the root mean square distance of the simulated particles from the observed ones
+	int iterations;
+	size_t rollouts;  // the candidate probes simulated
+	double seconds;  // the latency of the fit
+};
+
+/* Fits the center and the radius of the ball pressed into the cloth to a shape of the cloth observed from outside (e.g.
+ by a camera looking at the membrane of a tactile sensor), minimizing the squared distances of the particles of a
+ simulated cloth from the observed ones. A candidate probe is simulated by restoring a copy of the cloth from the start
+ (the warm start, e.g. the membrane settled without contact, see ClothState) and holding the ball in it for
+ params.frames frames, as the observation was made.
+ The fit is Levenberg-Marquardt over the 4 parameters of the probe. Each iteration runs two batches of rollouts, each
+ on the work-stealing tasks of the pool as the members of an Ensemble: the 4 finite differences of the current probe,
+ which give the Jacobian of the particles, and then the steps for NUM_DAMPINGS dampings around the current one at once,
+ of which the best is kept. Trying the dampings in parallel replaces the serial retries of a rejected step, so an
+ iteration takes the time of two rollouts on 4 or more threads. Each rollout is stepped on one thread and the batches
+ are reduced in a fixed order, so the estimate does not depend on the number of threads.
+ The first guess has to touch the cloth: a probe that does not has no gradient. */
+class ProbeEstimator {
+private:
+	ThreadPool *pool;  // not owned
+	EnsembleParams cloth_params;
+	ProbeEstimatorParams params;
+	std::shared_ptr <const ClothState> start;
+	std::vector <std::unique_ptr <Cloth> > cloths;  // the rollouts of a batch, one per candidate
+	std::vector <Eigen::Vector4d> candidates;  // center and radius
+	std::vector <double> errors;  // the sum of the squared distances of each candidate
+	std::vector <float> fit_x, fit_y, fit_z;  // the particles of the current probe
+
+	/* Restores the cloth of the candidate c from the start and holds the candidate probe in it */
+	void rollout(size_t c);
+
+	/* Simulates the candidates [0, num_candidates) and measures their errors */
+	void runBatch(size_t num_candidates, const std::vector <Vec3> &observed);
+
+public:
+
+	/* The number of dampings tried in each iteration */
+	static const int NUM_DAMPINGS = 4;
+
+	/* The cloths are made with the size, grid, stiffness and damping of cloth_params, and start flat. The rollouts of a
+	 batch run on the threads of the pool, or on the calling thread if it is NULL. */
+	ProbeEstimator(const EnsembleParams &cloth_params, const ProbeEstimatorParams &params, ThreadPool *pool);
+
+	/* Starts the rollouts from the state instead of the flat cloth, returns false if it is not of the grid */
+	bool setStart(std::shared_ptr <const ClothState> start);
+
+	const ProbeEstimatorParams& getParams() const { return params; }
+
+	/* Simulates the cloth with the probe held in it, as a rollout does */
+	void simulate(const Vec3 &center, float radius, std::vector <Vec3> &positions);
+
+	/* Fits the probe to the observed positions of the particles, starting from the guess. Returns false if there is
+	 not one position per particle. */
+	bool estimate(const std::vector <Vec3> &observed, const Vec3 &center, float radius, ProbeEstimate &estimate);
+};
@@ -0,0 +1,144 @@
+/**
+ * @file Profiler.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <math.h>
+
+/* ******************************************************************************************** */
+ProfileBuffer::ProfileBuffer(int thread, size_t capacity) : events(capacity), head(0), tail(0), thread(thread) {}
+
+/* ******************************************************************************************** */
+uint64_t ProfileBuffer::drain(std::vector <ProfileEvent> &out) {
+	const uint64_t capacity = events.size();
+	uint64_t end = head.load(std::memory_order_acquire);
+	uint64_t lost = 0;
+	if(end - tail > capacity) {
+		lost = end - tail - capacity;
+		tail = end - capacity;
+	}
+	size_t first = out.size();
+	for(uint64_t i = tail; i < end; i++)
+		out.push_back(events[i & (capacity - 1)]);
+
+	// The thread kept pushing while we copied; the slots it has wrapped around to since, and the one it may be writing,
+	// may have been torn
+	std::atomic_thread_fence(std::memory_order_acquire);
+	uint64_t now = head.load(std::memory_order_relaxed) + 1;
+	if(now - tail > capacity) {
+		uint64_t torn = std::min(now - tail - capacity, end - tail);
+		out.erase(out.begin() + first, out.begin() + first + torn);
+		lost += torn;
+	}
+	tail = end;
+	return lost;
+}
+
+/* ******************************************************************************************** */
+Profiler::Profiler() : epoch(std::chrono::steady_clock::now()), dropped(0) {}
+
+/* ******************************************************************************************** */
+Profiler& Profiler::instance() {
+	static Profiler profiler;
+	return profiler;
+}
+
+/* ******************************************************************************************** */
+ProfileBuffer* Profiler::addBuffer() {
+	std::lock_guard <std::mutex> lock(mutex);
+	buffers.push_back(std::unique_ptr <ProfileBuffer>(new ProfileBuffer((int) buffers.size(), BUFFER_CAPACITY)));
+	return buffers.back().get();
+}
+
+/* ******************************************************************************************** */
+void Profiler::drain(std::vector <ProfileEvent> &events) {
+	std::lock_guard <std::mutex> lock(mutex);
+	for(size_t b = 0; b < buffers.size(); b++)
+		dropped += buffers[b]->drain(events);
+}
+
+/* ******************************************************************************************** */
+uint64_t Profiler::getDropped() {
+	std::lock_guard <std::mutex> lock(mutex);
+	return dropped;
+}
+
+/* ******************************************************************************************** */
+bool ChromeTraceWriter::open(const char *path) {
+	close();
+	file = fopen(path, "w");
+	if(file == NULL) return false;
+	first = true;
+	fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	return true;
+}
+
+/* ******************************************************************************************** */
+void ChromeTraceWriter::write(const std::vector <ProfileEvent> &events) {
+	if(file == NULL) return;
+
+	// The format counts in microseconds
+	for(size_t i = 0; i < events.size(); i++) {
+		const ProfileEvent &event = events[i];
+		fprintf(file, first ? "" : ",\n");
+		first = false;
+		if(event.is_counter)
+			fprintf(file, "{\"name\": \"%s\", \"ph\": \"C\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d, \"args\": {\"value\": %g}}",
+					event.name, event.start * 1e-3, event.thread, event.value);
+		else fprintf(file, "{\"name\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d}",
+				event.name, event.start * 1e-3, event.value * 1e-3, event.thread);
+	}
+}
+
+/* ******************************************************************************************** */
+bool ChromeTraceWriter::close() {
+	if(file == NULL) return true;
+	fprintf(file, "\n]}\n");
+	bool written = !ferror(file);
+	written = (fclose(file) == 0) && written;
+	file = NULL;
+	return written;
+}
+
+/* ******************************************************************************************** */
+void ProfileSummary::add(const std::vector <ProfileEvent> &events) {
+	for(size_t i = 0; i < events.size(); i++) {
+		Series &series = this->series[events[i].name];
+		series.is_counter = events[i].is_counter;
+		double value = series.is_counter ? events[i].value : events[i].value * 1e-3;  // the scopes in microseconds
+		if(series.window.size() < window_size) series.window.push_back(value);
+		else series.window[series.total % window_size] = value;
+		series.total++;
+	}
+}
+
+/* ******************************************************************************************** */
+void ProfileSummary::write(FILE *file) const {
+	fprintf(file, "%-16s %8s %10s %10s %10s %10s %10s  %s\n", "scope/counter", "count", "mean", "p50", "p90", "p99", "max",
+			"histogram of the last events, count per [2^k, 2^(k+1))");
+	for(std::map <std::string, Series>::const_iterator it = series.begin(); it != series.end(); it++) {
+		const Series &current = it->second;
+		std::vector <double> sorted = current.window;
+		std::sort(sorted.begin(), sorted.end());
+		double sum = 0.0;
+		std::map <int, size_t> buckets;
+		for(size_t i = 0; i < sorted.size(); i++) {
+			sum += sorted[i];
+			if(sorted[i] > 0.0) buckets[(int) floor(log2(sorted[i]))]++;
+			else buckets[INT32_MIN]++;
+		}
+		const size_t n = sorted.size();
+		fprintf(file, "%-16s %8lu %10.4g %10.4g %10.4g %10.4g %10.4g %s", it->first.c_str(), (unsigned long) current.total,
+				sum / n, sorted[n / 2], sorted[n * 9 / 10], sorted[n * 99 / 100], sorted[n - 1], current.is_counter ? "  " : "us");
+		for(std::map <int, size_t>::const_iterator bucket = buckets.begin(); bucket != buckets.end(); bucket++) {
+			if(bucket->first == INT32_MIN) fprintf(file, " <=0:%lu", (unsigned long) bucket->second);
+			else fprintf(file, " %g:%lu", ldexp(1.0, bucket->first), (unsigned long) bucket->second);
+		}
+		fprintf(file, "\n");
+	}
+}
@@ -0,0 +1,171 @@
+/**
+ * @file Profiler.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief Scoped timers and counters for the phases of a frame, recorded into a ring buffer per thread and exported as
+ * a Chrome trace or as a rolling summary. The macros compile to nothing unless CLOTH_ENABLE_PROFILING is defined.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#ifdef CLOTH_ENABLE_PROFILING
+#define CLOTH_PROFILE_JOIN2(a, b) a##b
+#define CLOTH_PROFILE_JOIN(a, b) CLOTH_PROFILE_JOIN2(a, b)
+
+/* Times the rest of the enclosing scope under name, which must be a string literal */
+#define CLOTH_PROFILE_SCOPE(name) ProfileScope CLOTH_PROFILE_JOIN(profile_scope_, __LINE__)(name)
+
+/* Records the value of the counter name, which must be a string literal */
+#define CLOTH_PROFILE_COUNTER(name, value) Profiler::instance().count(name, (double) (value))
+#else
+#define CLOTH_PROFILE_SCOPE(name) do {} while(0)
+#define CLOTH_PROFILE_COUNTER(name, value) do {} while(0)
+#endif
+
+/* Whether the macros above record anything in this build */
+inline bool profilingEnabled() {
+#ifdef CLOTH_ENABLE_PROFILING
+	return true;
+#else
+	return false;
+#endif
+}
+
+/* A scope that took value ns from start, or the value of a counter at start */
+struct ProfileEvent {
+	const char *name;  // a string literal, so that the pointer can be kept
+	uint64_t start;  // ns since the profiler was created
+	double value;
+	int thread;  // the order in which the threads first recorded something
+	bool is_counter;
+};
+
+/* The events of one thread. Only that thread pushes, without locking; the drain copies the events out and drops the
+ ones the thread may have overwritten in the meantime, so a thread that records faster than the drains only loses its
+ oldest events. */
+class ProfileBuffer {
+private:
+	std::vector <ProfileEvent> events;  // a power of two of them
+	std::atomic <uint64_t> head;  // the number of events ever pushed
+	uint64_t tail;  // the number of events drained or dropped, only used by the drain
+
+public:
+	const int thread;
+
+	ProfileBuffer(int thread, size_t capacity);
+
+	void push(const ProfileEvent &event) {
+		uint64_t index = head.load(std::memory_order_relaxed);
+		events[index & (events.size() - 1)] = event;
+		head.store(index + 1, std::memory_order_release);
+	}
+
+	/* Appends the events pushed since the last drain to out and returns how many were lost */
+	uint64_t drain(std::vector <ProfileEvent> &out);
+};
+
+/* Hands each thread its buffer and collects the events of all of them */
+class Profiler {
+private:
+	std::mutex mutex;  // guards the list of buffers and the drains, never taken when recording
+	std::vector <std::unique_ptr <ProfileBuffer> > buffers;  // kept after their threads end, for the last drain
+	const std::chrono::steady_clock::time_point epoch;
+	uint64_t dropped;
+
+	Profiler();
+	ProfileBuffer* addBuffer();
+
+public:
+	static const size_t BUFFER_CAPACITY = 1 << 16;  // events per thread between two drains
+
+	static Profiler& instance();
+
+	/* The buffer of the calling thread */
+	ProfileBuffer& buffer() {
+		static thread_local ProfileBuffer *buffer = NULL;
+		if(buffer == NULL) buffer = addBuffer();
+		return *buffer;
+	}
+
+	uint64_t now() const {
+		return std::chrono::duration_cast <std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	void count(const char *name, double value) {
+		ProfileBuffer &buffer = this->buffer();
+		ProfileEvent event = {name, now(), value, buffer.thread, true};
+		buffer.push(event);
+	}
+
+	/* Appends the events of all the threads recorded since the last drain to events, by thread and in order within a
+	 thread. It can be called from any thread. */
+	void drain(std::vector <ProfileEvent> &events);
+
+	/* The events lost because a buffer was not drained in time */
+	uint64_t getDropped();
+};
+
+/* Records the time from its construction to its destruction */
+class ProfileScope {
+private:
+	const char *name;
+	uint64_t start;
+
+public:
+	explicit ProfileScope(const char *name) : name(name), start(Profiler::instance().now()) {}
+	~ProfileScope() {
+		Profiler &profiler = Profiler::instance();
+		ProfileBuffer &buffer = profiler.buffer();
+		ProfileEvent event = {name, start, (double) (profiler.now() - start), buffer.thread, false};
+		buffer.push(event);
+	}
+};
+
+/* Writes drained events to a file in the Trace Event Format that chrome://tracing and Perfetto open: the scopes as
+ complete events on the timeline of their thread, the counters as counter tracks */
+class ChromeTraceWriter {
+private:
+	FILE *file;
+	bool first;  // no event written yet, so no comma before the next
+
+public:
+	ChromeTraceWriter() : file(NULL), first(true) {}
+	~ChromeTraceWriter() { close(); }
+
+	bool open(const char *path);
+	void write(const std::vector <ProfileEvent> &events);
+
+	/* Finishes the file, false if it could not be written completely */
+	bool close();
+};
+
+/* The distribution of each scope and counter over its last window events: count, mean, percentiles and a histogram
+ with a bucket per power of two */
+class ProfileSummary {
+private:
+	struct Series {
+		bool is_counter;
+		uint64_t total;  // the events ever added
+		std::vector <double> window;  // the last ones, from total % window size on
+	};
+	std::map <std::string, Series> series;
+	size_t window_size;
+
+public:
+	explicit ProfileSummary(size_t window_size = 1000) : window_size(window_size) {}
+
+	void add(const std::vector <ProfileEvent> &events);
+
+	/* Writes a table of the scopes in microseconds and of the counters, sorted by name */
+	void write(FILE *file) const;
+};
@@ -0,0 +1,292 @@
+/**
+ * @file SelfCollision.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "SelfCollision.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+// The floats of the frame of a triangle, 4 planes as (normal, offset): the triangle now and before the step, and the
+// barycentric coordinates v and w
+static const int FRAME_SIZE = 16;
+static const uint32_t NO_BUCKET = 0xffffffffu;  // of a triangle that is left out
+
+/* ******************************************************************************************** */
+static uint64_t edgeKey(uint32_t p1, uint32_t p2) {
+	return (uint64_t) std::min(p1, p2) << 32 | std::max(p1, p2);
+}
+
+/* ******************************************************************************************** */
+SelfCollision::SelfCollision(const Constraints &constraints, std::shared_ptr <const std::vector <uint32_t> > triangles,
+		float thickness) : thickness(thickness), triangles(triangles), bucket_mask(0), num_contacts(0) {
+	float shortest = INFINITY;
+	std::vector <std::pair <uint64_t, float> > rest(constraints.size());
+	for(size_t c = 0; c < constraints.size(); c++) {
+		shortest = std::min(shortest, constraints.rest_distance[c]);
+		const ConstraintPair &pair = constraints.pairs[c];
+		rest[c] = std::make_pair(edgeKey(pair.p1, pair.p2), constraints.rest_distance[c]);
+	}
+	if(shortest == INFINITY) shortest = 1.0f;
+	if(this->thickness <= 0.0f) this->thickness = 0.5f * shortest;
+
+	// The cells are as large as the box of the longest edge of the triangles at rest, so that a particle looks for the
+	// triangles over it in a few cells
+	std::sort(rest.begin(), rest.end());
+	float longest = shortest;
+	const std::vector <uint32_t> &corners = *triangles;
+	for(size_t t = 0; t + 2 < corners.size(); t += 3) {
+		for(int k = 0; k < 3; k++) {
+			uint64_t key = edgeKey(corners[t + k], corners[t + (k + 1) % 3]);
+			std::vector <std::pair <uint64_t, float> >::const_iterator it = std::lower_bound(rest.begin(), rest.end(),
+					std::make_pair(key, -INFINITY));
+			if(it != rest.end() && it->first == key) longest = std::max(longest, it->second);
+		}
+	}
+	cell_size = longest + 2.0f * this->thickness;
+}
+
+/* ******************************************************************************************** */
+/* Adds the bucket to the list of the buckets to visit unless it is already in it, since two cells can share one */
+static void addBucket(uint32_t bucket, uint32_t *buckets, int &num_buckets) {
+	for(int i = 0; i < num_buckets; i++)
+		if(buckets[i] == bucket) return;
+	buckets[num_buckets++] = bucket;
+}
+
+/* ******************************************************************************************** */
+void SelfCollision::build(const Particles &particles) {
+	const size_t n = particles.size();
+	const std::vector <uint32_t> &corners = *triangles;
+	const size_t num_triangles = corners.size() / 3;
+
+	// Twice as many buckets as particles, as in ParticleGrid
+	uint32_t num_buckets = 1;
+	while(num_buckets < 2 * n)
+		num_buckets <<= 1;
+	bucket_mask = num_buckets - 1;
+
+	// Counting sort of the particles by the bucket of their cell
+	particle_bucket.resize(n);
+	particle_start.assign(num_buckets + 1, 0);
+	for(size_t i = 0; i < n; i++) {
+		particle_bucket[i] = hash(cellOf(particles.x[i]), cellOf(particles.y[i]), cellOf(particles.z[i])) & bucket_mask;
+		particle_start[particle_bucket[i] + 1]++;
+	}
+	for(uint32_t b = 0; b < num_buckets; b++)
+		particle_start[b + 1] += particle_start[b];
+	particle_entries.resize(n);
+	std::vector <uint32_t> next(particle_start.begin(), particle_start.end() - 1);
+	for(size_t i = 0; i < n; i++)
+		particle_entries[next[particle_bucket[i]]++] = i;
+
+	// The frame of each triangle, and its bucket by the cell of the low corner of its box
+	frames.resize(FRAME_SIZE * num_triangles);
+	boxes.resize(6 * num_triangles);
+	triangle_bucket.resize(num_triangles);
+	triangle_start.assign(num_buckets + 1, 0);
+	for(int k = 0; k < 3; k++)
+		max_extent[k] = 0.0f;
+	for(size_t t = 0; t < num_triangles; t++) {
+		uint32_t i0 = corners[3 * t], i1 = corners[3 * t + 1], i2 = corners[3 * t + 2];
+		Vec3 a = particles.getPos(i0), e1 = particles.getPos(i1) - a, e2 = particles.getPos(i2) - a;
+		Vec3 old_a = particles.getOldPos(i0);
+		Vec3 normal = e1.cross(e2), old_normal = (particles.getOldPos(i1) - old_a).cross(particles.getOldPos(i2) - old_a);
+		float length = normal.length(), old_length = old_normal.length();
+		float d00 = e1.dot(e1), d01 = e1.dot(e2), d11 = e2.dot(e2), denominator = d00 * d11 - d01 * d01;
+		float *box = &boxes[6 * t];
+		bool torn = !(denominator > 0.0f) || !(old_length > 0.0f);  // degenerate
+		for(int k = 0; k < 3; k++) {
+			float v0 = a.f[k], v1 = v0 + e1.f[k], v2 = v0 + e2.f[k];
+			box[k] = std::min(v0, std::min(v1, v2)) - thickness;
+			box[3 + k] = std::max(v0, std::max(v1, v2)) + thickness;
+			torn = torn || !(box[3 + k] - box[k] <= MAX_EXTENT * cell_size);
+		}
+		if(torn) {
+			triangle_bucket[t] = NO_BUCKET;
+			continue;
+		}
+
+		// The planes now and before the step, and the barycentric coordinates v and w of a point as planes too
+		Vec3 planes[4] = {normal / length, old_normal / old_length, (e1 * d11 - e2 * d01) / denominator,
+				(e2 * d00 - e1 * d01) / denominator};
+		const Vec3 origins[4] = {a, old_a, a, a};
+		float *frame = &frames[FRAME_SIZE * t];
+		for(int j = 0; j < 4; j++) {
+			for(int k = 0; k < 3; k++)
+				frame[4 * j + k] = planes[j].f[k];
+			frame[4 * j + 3] = planes[j].dot(origins[j]);
+		}
+
+		for(int k = 0; k < 3; k++)
+			max_extent[k] = std::max(max_extent[k], box[3 + k] - box[k]);
+		triangle_bucket[t] = hash(cellOf(box[0]), cellOf(box[1]), cellOf(box[2])) & bucket_mask;
+		triangle_start[triangle_bucket[t] + 1]++;
+	}
+
+	// Counting sort of the triangles by their buckets
+	for(uint32_t b = 0; b < num_buckets; b++)
+		triangle_start[b + 1] += triangle_start[b];
+	triangle_entries.resize(triangle_start[num_buckets]);
+	next.assign(triangle_start.begin(), triangle_start.end() - 1);
+	for(size_t t = 0; t < num_triangles; t++)
+		if(triangle_bucket[t] != NO_BUCKET) triangle_entries[next[triangle_bucket[t]]++] = t;
+}
+
+/* ******************************************************************************************** */
+bool SelfCollision::contactTriangle(const Particles &particles, uint32_t p, const Vec3 &pos, uint32_t t,
+		SelfContact &contact) const {
+	const float *frame = &frames[FRAME_SIZE * t];
+
+	// The side of the triangle the particle was on before the step is the one it has to stay on
+	float distance = pos.f[0] * frame[0] + pos.f[1] * frame[1] + pos.f[2] * frame[2] - frame[3];
+	float old_distance = particles.old_x[p] * frame[4] + particles.old_y[p] * frame[5] + particles.old_z[p] * frame[6]
+			- frame[7];
+	float side = (old_distance > 0.0f || (old_distance == 0.0f && distance >= 0.0f)) ? 1.0f : -1.0f;
+	float separation = side * distance;
+	if(separation >= thickness) return false;
+
+	// Only if the particle is over the triangle, in barycentric coordinates (u, v, w) of its projection, and not one
+	// of its corners
+	float v = pos.f[0] * frame[8] + pos.f[1] * frame[9] + pos.f[2] * frame[10] - frame[11];
+	float w = pos.f[0] * frame[12] + pos.f[1] * frame[13] + pos.f[2] * frame[14] - frame[15];
+	float u = 1.0f - v - w;
+	if(u < 0.0f || v < 0.0f || w < 0.0f) return false;
+	const uint32_t *corner = &(*triangles)[3 * t];
+	if(corner[0] == p || corner[1] == p || corner[2] == p) return false;
+
+	// Move the particle and the point of the triangle under it apart, by their inverse masses
+	const std::vector <float> &inv_mass = particles.inv_mass;
+	float weights[4] = {1.0f, -u, -v, -w};
+	float total = inv_mass[p] + u * u * inv_mass[corner[0]] + v * v * inv_mass[corner[1]] + w * w * inv_mass[corner[2]];
+	if(total == 0.0f) return false;
+	float lambda = (thickness - separation) / total;
+	contact.particles[0] = p;
+	for(int k = 0; k < 3; k++)
+		contact.particles[k + 1] = corner[k];
+	for(int k = 0; k < 4; k++)
+		contact.scale[k] = lambda * weights[k] * inv_mass[contact.particles[k]];
+	contact.normal = Vec3(frame[0], frame[1], frame[2]) * side;
+	contact.num_particles = 4;
+	return true;
+}
+
+/* ******************************************************************************************** */
+void SelfCollision::detect(const Particles &particles, size_t task, std::vector <SelfContact> &contacts) const {
+	const std::vector <float> &inv_mass = particles.inv_mass;
+	const float thickness2 = thickness * thickness;
+	size_t begin = task * PARTICLES_PER_TASK, end = std::min(begin + PARTICLES_PER_TASK, particles.size());
+	SelfContact contact;
+	uint32_t buckets[(MAX_EXTENT + 2) * (MAX_EXTENT + 2) * (MAX_EXTENT + 2)];
+	int num_buckets;
+	for(uint32_t p = begin; p < end; p++) {
+		Vec3 pos = particles.getPos(p);
+
+		// The particles after it in the cells its sphere of the thickness overlaps, so that each pair is found once
+		int32_t lo[3], hi[3];
+		for(int k = 0; k < 3; k++) {
+			lo[k] = cellOf(pos.f[k] - thickness);
+			hi[k] = cellOf(pos.f[k] + thickness);
+		}
+		num_buckets = 0;
+		for(int32_t x = lo[0]; x <= hi[0]; x++)
+			for(int32_t y = lo[1]; y <= hi[1]; y++)
+				for(int32_t z = lo[2]; z <= hi[2]; z++)
+					addBucket(hash(x, y, z) & bucket_mask, buckets, num_buckets);
+		for(int i = 0; i < num_buckets; i++) {
+			for(uint32_t f = particle_start[buckets[i]]; f < particle_start[buckets[i] + 1]; f++) {
+				const uint32_t q = particle_entries[f];
+				if(q <= p) continue;
+				Vec3 v = pos - particles.getPos(q);
+				float distance2 = v.dot(v);
+				float total = inv_mass[p] + inv_mass[q];
+				if(distance2 >= thickness2 || distance2 == 0.0f || total == 0.0f) continue;
+				float distance = sqrtf(distance2);
+				float lambda = (thickness - distance) / total;
+				contact.particles[0] = p;
+				contact.particles[1] = q;
+				contact.scale[0] = lambda * inv_mass[p];
+				contact.scale[1] = -lambda * inv_mass[q];
+				contact.normal = v / distance;
+				contact.num_particles = 2;
+				contacts.push_back(contact);
+			}
+		}
+
+		// The triangles whose boxes can hold it start in the cells below it within the size of the largest box
+		for(int k = 0; k < 3; k++) {
+			lo[k] = cellOf(pos.f[k] - max_extent[k]);
+			hi[k] = cellOf(pos.f[k]);
+		}
+		num_buckets = 0;
+		for(int32_t x = lo[0]; x <= hi[0]; x++)
+			for(int32_t y = lo[1]; y <= hi[1]; y++)
+				for(int32_t z = lo[2]; z <= hi[2]; z++)
+					addBucket(hash(x, y, z) & bucket_mask, buckets, num_buckets);
+		for(int i = 0; i < num_buckets; i++) {
+			for(uint32_t f = triangle_start[buckets[i]]; f < triangle_start[buckets[i] + 1]; f++) {
+				const uint32_t t = triangle_entries[f];
+				const float *box = &boxes[6 * t];
+				if(pos.f[0] < box[0] || pos.f[1] < box[1] || pos.f[2] < box[2] || pos.f[0] > box[3] || pos.f[1] > box[4]
+						|| pos.f[2] > box[5]) continue;
+				if(contactTriangle(particles, p, pos, t, contact)) contacts.push_back(contact);
+			}
+		}
+	}
+}
+
+/* ******************************************************************************************** */
+void SelfCollision::solve(Particles &particles, ThreadPool *pool) {
+	build(particles);
+
+	// Find the contacts of the tasks, on the threads if there are any
+	const size_t num_tasks = (particles.size() + PARTICLES_PER_TASK - 1) / PARTICLES_PER_TASK;
+	task_contacts.resize(num_tasks);
+	for(size_t task = 0; task < num_tasks; task++)
+		task_contacts[task].clear();
+	if(pool != NULL && pool->size() > 1)
+		pool->runTasks(num_tasks, [&](size_t task, int) { detect(particles, task, task_contacts[task]); });
+	else {
+		for(size_t task = 0; task < num_tasks; task++)
+			detect(particles, task, task_contacts[task]);
+	}
+
+	// Sum up the corrections of each particle in the order of the tasks, then move it by their average
+	const size_t n = particles.size();
+	if(num_corrections.size() != n) {
+		delta_x.assign(n, 0.0f);
+		delta_y.assign(n, 0.0f);
+		delta_z.assign(n, 0.0f);
+		num_corrections.assign(n, 0);
+	}
+	moved.clear();
+	num_contacts = 0;
+	for(size_t task = 0; task < num_tasks; task++) {
+		const std::vector <SelfContact> &contacts = task_contacts[task];
+		num_contacts += contacts.size();
+		for(size_t c = 0; c < contacts.size(); c++) {
+			const SelfContact &contact = contacts[c];
+			for(int k = 0; k < contact.num_particles; k++) {
+				if(contact.scale[k] == 0.0f) continue;
+				uint32_t i = contact.particles[k];
+				if(num_corrections[i]++ == 0) moved.push_back(i);
+				delta_x[i] += contact.scale[k] * contact.normal.f[0];
+				delta_y[i] += contact.scale[k] * contact.normal.f[1];
+				delta_z[i] += contact.scale[k] * contact.normal.f[2];
+			}
+		}
+	}
+	for(size_t m = 0; m < moved.size(); m++) {
+		uint32_t i = moved[m];
+		float scale = 1.0f / num_corrections[i];
+		particles.x[i] += delta_x[i] * scale;
+		particles.y[i] += delta_y[i] * scale;
+		particles.z[i] += delta_z[i] * scale;
+		delta_x[i] = delta_y[i] = delta_z[i] = 0.0f;
+		num_corrections[i] = 0;
+	}
+}
@@ -0,0 +1,99 @@
+/**
+ * @file SelfCollision.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief Keeps the layers of a folded cloth apart, with the particles and triangles hashed into cells every frame
+ */
+
+#pragma once
+
+#include "Constraint.h"
+
+#include <math.h>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+class ThreadPool;
+
+/* A contact between the particles of the cloth: moving particle k by scale[k] * normal resolves it. The second
+ particle of a particle-particle contact has num_particles = 2, a particle and the corners of a triangle have 4. */
+struct SelfContact {
+	uint32_t particles[4];
+	float scale[4];
+	Vec3 normal;
+	int num_particles;
+};
+
+/* Detects and resolves the contacts of the cloth with itself: two particles closer than the thickness, and a particle
+ closer than the thickness to a triangle it is not a corner of, or that went through the triangle in the last time
+ step. The particle is pushed back to the side of the triangle it was on at its old position, so the layers of a fold
+ cannot pass through each other even between the particles.
+ Every frame the particles are bucketed by the cell they are in, and each triangle by the cell of the low corner of
+ its box grown by the thickness, with a counting sort as ParticleGrid does. A particle is then only compared to the
+ particles in the cells its sphere of the thickness overlaps, and to the triangles that start in the cells below it
+ within the size of the largest box (mostly 2 x 2 x 1 of them), so the cost grows with the number of particles and not
+ its square. The threads of a pool take the particles in tasks of a fixed number of consecutive ones, which are close
+ together on the grid or on a Morton ordered mesh, so the cells a task looks up stay in the cache. The contacts are
+ resolved in the order of the tasks: each particle is moved by the average of the corrections of its contacts, as in a
+ Jacobi iteration, so the result does not depend on the number of threads.
+ The unmovable particles (pinned or in a sleeping tile) are obstacles that are not moved themselves. */
+class SelfCollision {
+private:
+	float thickness;  // the distance kept between the layers
+	float cell_size;  // the longest edge of the triangles at rest and twice the thickness, the box of a triangle at rest
+	std::shared_ptr <const std::vector <uint32_t> > triangles;  // three particles each
+	uint32_t bucket_mask;  // the number of buckets minus 1, a power of 2 minus 1
+
+	std::vector <uint32_t> particle_bucket;  // the bucket of the cell of each particle
+	std::vector <uint32_t> particle_start;  // the particles of bucket b are particle_entries[particle_start[b]...[b+1])
+	std::vector <uint32_t> particle_entries;
+	std::vector <uint32_t> triangle_bucket;  // the bucket of the cell of the low corner of the box of each triangle
+	std::vector <uint32_t> triangle_start;  // the same for the triangles, by the low corners of their boxes
+	std::vector <uint32_t> triangle_entries;
+	std::vector <float> frames;  // the planes of each triangle now and before the step, and of its barycentric coordinates
+	std::vector <float> boxes;  // the box of each triangle grown by the thickness, low then high corner
+	float max_extent[3];  // the largest size of the boxes of the triangles along each axis
+	std::vector <std::vector <SelfContact> > task_contacts;  // the contacts found by each task
+	std::vector <float> delta_x, delta_y, delta_z;  // the sum of the corrections of each particle
+	std::vector <uint32_t> num_corrections;  // the number of contacts that move each particle
+	std::vector <uint32_t> moved;  // the particles with corrections
+	size_t num_contacts;  // in the last solve()
+
+	static uint32_t hash(int32_t x, int32_t y, int32_t z) {
+		return ((uint32_t) x * 73856093u) ^ ((uint32_t) y * 19349663u) ^ ((uint32_t) z * 83492791u);
+	}
+
+	int32_t cellOf(float v) const { return (int32_t) floorf(v / cell_size); }
+
+	/* Buckets the particles and the triangles, and computes the frames of the triangles */
+	void build(const Particles &particles);
+
+	/* Finds the contacts of the particles of a task */
+	void detect(const Particles &particles, size_t task, std::vector <SelfContact> &contacts) const;
+
+	/* The contact of the particle p at pos, inside the box of the triangle t, with the triangle */
+	bool contactTriangle(const Particles &particles, uint32_t p, const Vec3 &pos, uint32_t t, SelfContact &contact) const;
+
+public:
+
+	/* A triangle whose box is larger than this many cells along an axis is torn apart, and left out */
+	static const int MAX_EXTENT = 2;
+
+	/* The consecutive particles of a task */
+	static const size_t PARTICLES_PER_TASK = 1024;
+
+	/* The particles of the cloth are connected by the constraints, and form the triangles. A thickness of 0 picks
+	 half of the shortest rest distance, so that the particles of the cloth at rest are never in contact. */
+	SelfCollision(const Constraints &constraints, std::shared_ptr <const std::vector <uint32_t> > triangles,
+			float thickness = 0.0f);
+
+	float getThickness() const { return thickness; }
+	float getCellSize() const { return cell_size; }
+
+	/* Pushes the particles in contact apart once, detecting the contacts on the threads of the pool if there is one */
+	void solve(Particles &particles, ThreadPool *pool);
+
+	/* The contacts resolved by the last solve() */
+	size_t numContacts() const { return num_contacts; }
+};
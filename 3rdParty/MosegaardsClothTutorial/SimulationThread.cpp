@@ -0,0 +1,73 @@
+/**
+ * @file SimulationThread.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "SimulationThread.h"
+
+#include <chrono>
+
+/* ******************************************************************************************** */
+SimulationThread::SimulationThread(Cloth &cloth, const Vec3 &ball_center, float ball_radius, double steps_per_second) :
+		cloth(cloth), ball_center(ball_center), ball_radius(ball_radius), steps_per_second(steps_per_second),
+		running(false), steps(0) {
+}
+
+/* ******************************************************************************************** */
+void SimulationThread::start() {
+	if(running) return;
+	running = true;
+	thread = std::thread(&SimulationThread::loop, this);
+}
+
+/* ******************************************************************************************** */
+void SimulationThread::stop() {
+	if(!running) return;
+	running = false;
+	thread.join();
+}
+
+/* ******************************************************************************************** */
+void SimulationThread::loop() {
+	typedef std::chrono::steady_clock Clock;
+	const Clock::duration period = std::chrono::duration_cast <Clock::duration>(
+			std::chrono::duration <double>(1.0 / steps_per_second));
+	Clock::time_point next = Clock::now();
+	while(running) {
+
+		// Apply the moves of the ball that came in since the last step
+		Vec3 offset;
+		while(ball_moves.pop(offset))
+			ball_center = ball_center + offset;
+
+		cloth.timeStep();  // calculate the particle positions of the next frame
+		cloth.ballCollision(ball_center, ball_radius);  // resolve collision with the ball
+		cloth.computeNormals();
+		steps++;
+
+		// Publish the step, the buffer is ours until publish()
+		const Particles &particles = cloth.getParticles();
+		ClothSnapshot &snapshot = snapshots.writeBuffer();
+		snapshot.step = steps;
+		snapshot.width = cloth.getNumParticlesWidth();
+		snapshot.height = cloth.getNumParticlesHeight();
+		snapshot.x = particles.x;
+		snapshot.y = particles.y;
+		snapshot.z = particles.z;
+		snapshot.normal_x = particles.normal_x;
+		snapshot.normal_y = particles.normal_y;
+		snapshot.normal_z = particles.normal_z;
+		snapshot.triangles = cloth.getTriangles();
+		snapshot.ball_center = ball_center;
+		snapshot.ball_radius = ball_radius;
+		snapshots.publish();
+
+		// Keep the rate, but do not try to catch up on more than a few steps if a step took too long
+		next += period;
+		Clock::time_point now = Clock::now();
+		if(now > next + 4 * period) next = now;
+		std::this_thread::sleep_until(next);
+	}
+}
@@ -0,0 +1,66 @@
+/**
+ * @file SimulationThread.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief Steps a cloth at a fixed rate on its own thread, independently of how fast it is drawn
+ */
+
+#pragma once
+
+#include "Cloth.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+/* A copy of what is needed to draw the cloth after a time step */
+struct ClothSnapshot {
+	uint64_t step;  // the number of time steps taken, 0 if nothing was published yet
+	int width, height;  // the particles of the grid, see Cloth::getParticle()
+	std::vector <float> x, y, z;  // the positions of the particles
+	std::vector <float> normal_x, normal_y, normal_z;  // the normals of the particles, not unit length
+	std::shared_ptr <const std::vector <uint32_t> > triangles;  // of a cloth made from a mesh, shared with it
+	Vec3 ball_center;
+	float ball_radius;
+
+	ClothSnapshot() : step(0), width(0), height(0), ball_center(0, 0, 0), ball_radius(0) {}
+};
+
+/* Runs the time steps and the ball collision of a cloth on a thread of its own, at a fixed number of steps per second.
+ After each step the positions and normals are published through a triple buffer, which the render thread reads without
+ ever blocking the physics, and the moves of the ball are queued from the render thread to the physics one. The cloth
+ must not be touched by any other thread while this runs. */
+class SimulationThread {
+private:
+	Cloth &cloth;
+	Vec3 ball_center;  // only used by the physics thread
+	float ball_radius;
+	double steps_per_second;
+	TripleBuffer <ClothSnapshot> snapshots;
+	SpscQueue <Vec3, 256> ball_moves;  // offsets of the ball requested by the render thread
+	std::thread thread;
+	std::atomic <bool> running;
+	uint64_t steps;
+
+	void loop();
+
+public:
+
+	SimulationThread(Cloth &cloth, const Vec3 &ball_center, float ball_radius, double steps_per_second);
+	~SimulationThread() { stop(); }
+
+	void start();
+	void stop();
+
+	/* Moves the ball by offset before the next time step. Returns false if too many moves are already waiting. */
+	bool moveBall(const Vec3 &offset) { return ball_moves.push(offset); }
+
+	/* The last published snapshot, for the render thread only */
+	const ClothSnapshot& latest() {
+		snapshots.update();
+		return snapshots.readBuffer();
+	}
+};
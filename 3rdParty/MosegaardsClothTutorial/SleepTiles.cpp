@@ -0,0 +1,217 @@
+/**
+ * @file SleepTiles.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "SleepTiles.h"
+
+#include <algorithm>
+#include <map>
+
+/* ******************************************************************************************** */
+SleepTiles::SleepTiles(const Constraints &constraints, const Particles &particles, int num_particles_width,
+		int num_particles_height, int tile_size, float threshold, int sleep_steps) :
+		num_particles_width(num_particles_width), num_particles_height(num_particles_height), tile_size(tile_size),
+		num_tiles_width((num_particles_width + tile_size - 1) / tile_size),
+		num_tiles_height((num_particles_height + tile_size - 1) / tile_size), threshold2(threshold * threshold),
+		sleep_steps(sleep_steps), inv_mass(particles.inv_mass) {
+	const size_t num_tiles = (size_t) num_tiles_width * num_tiles_height;
+	awake.assign(num_tiles, 1);
+	stepped.assign(num_tiles, 1);
+	quiet_steps.assign(num_tiles, 0);
+	settling_steps.assign(num_tiles, 0);
+	num_awake = num_tiles;
+
+	// The constraints are grouped by the tiles of their particles, in the order of the tiles of their first ones
+	std::map <std::pair <uint32_t, uint32_t>, size_t> links;
+	for(size_t c = 0; c < constraints.size(); c++)
+		links.insert(std::make_pair(std::make_pair(tileOf(constraints.pairs[c].p1), tileOf(constraints.pairs[c].p2)), 0));
+	for(std::map <std::pair <uint32_t, uint32_t>, size_t>::iterator it = links.begin(); it != links.end(); it++) {
+		it->second = link_tiles.size();
+		link_tiles.push_back(it->first);
+	}
+	link_constraints.resize(link_tiles.size());
+	for(size_t c = 0; c < constraints.size(); c++) {
+		Constraints &link = link_constraints[links[std::make_pair(tileOf(constraints.pairs[c].p1),
+				tileOf(constraints.pairs[c].p2))]];
+		link.pairs.push_back(constraints.pairs[c]);
+		link.rest_distance.push_back(constraints.rest_distance[c]);
+	}
+	for(size_t l = 0; l < link_constraints.size(); l++)
+		link_constraints[l].buildBatches();
+
+	// Everything is stepped until the first tiles fall asleep
+	active.resize(num_tiles);
+	for(uint32_t t = 0; t < num_tiles; t++)
+		active[t] = t;
+	active_ranges.push_back(0);
+	active_ranges.push_back(num_particles_width * num_particles_height);
+	active_links.resize(link_tiles.size());
+	for(uint32_t l = 0; l < link_tiles.size(); l++)
+		active_links[l] = l;
+}
+
+/* ******************************************************************************************** */
+void SleepTiles::tileBounds(uint32_t tile, int &x0, int &x1, int &y0, int &y1) const {
+	x0 = (tile % num_tiles_width) * tile_size;
+	y0 = (tile / num_tiles_width) * tile_size;
+	x1 = std::min(x0 + tile_size, num_particles_width);
+	y1 = std::min(y0 + tile_size, num_particles_height);
+}
+
+/* ******************************************************************************************** */
+void SleepTiles::settle(uint32_t tile) {
+	int tx = tile % num_tiles_width, ty = tile / num_tiles_width;
+	for(int ny = std::max(ty - 1, 0); ny <= std::min(ty + 1, num_tiles_height - 1); ny++)
+		for(int nx = std::max(tx - 1, 0); nx <= std::min(tx + 1, num_tiles_width - 1); nx++)
+			settling_steps[ny * num_tiles_width + nx] = sleep_steps;
+}
+
+/* ******************************************************************************************** */
+void SleepTiles::freeze(uint32_t tile, Particles &particles) {
+	int x0, x1, y0, y1;
+	tileBounds(tile, x0, x1, y0, y1);
+	for(int y = y0; y < y1; y++) {
+		for(size_t i = (size_t) y * num_particles_width + x0; i < (size_t) y * num_particles_width + x1; i++) {
+			inv_mass[i] = particles.inv_mass[i];
+			particles.inv_mass[i] = 0.0f;
+			particles.old_x[i] = particles.x[i];
+			particles.old_y[i] = particles.y[i];
+			particles.old_z[i] = particles.z[i];
+			particles.acc_x[i] = particles.acc_y[i] = particles.acc_z[i] = 0.0f;
+		}
+	}
+	stepped[tile] = 0;
+	settle(tile);
+}
+
+/* ******************************************************************************************** */
+void SleepTiles::thaw(uint32_t tile, Particles &particles) {
+	int x0, x1, y0, y1;
+	tileBounds(tile, x0, x1, y0, y1);
+	for(int y = y0; y < y1; y++) {
+		size_t begin = (size_t) y * num_particles_width + x0, end = (size_t) y * num_particles_width + x1;
+		std::copy(inv_mass.begin() + begin, inv_mass.begin() + end, particles.inv_mass.begin() + begin);
+	}
+	stepped[tile] = 1;
+	settle(tile);
+}
+
+/* ******************************************************************************************** */
+void SleepTiles::wakeTile(uint32_t tile, Particles &particles) {
+	if(!awake[tile]) num_awake++;
+	awake[tile] = 1;
+	quiet_steps[tile] = 0;
+
+	// The neighbors are stepped from now on, in time for the forces of the next time step
+	int tx = tile % num_tiles_width, ty = tile / num_tiles_width;
+	for(int ny = std::max(ty - 1, 0); ny <= std::min(ty + 1, num_tiles_height - 1); ny++)
+		for(int nx = std::max(tx - 1, 0); nx <= std::min(tx + 1, num_tiles_width - 1); nx++)
+			if(!stepped[ny * num_tiles_width + nx]) thaw(ny * num_tiles_width + nx, particles);
+}
+
+/* ******************************************************************************************** */
+void SleepTiles::wakeAll(Particles &particles) {
+	for(uint32_t t = 0; t < awake.size(); t++)
+		if(!stepped[t]) thaw(t, particles);
+	std::fill(awake.begin(), awake.end(), 1);
+	std::fill(quiet_steps.begin(), quiet_steps.end(), 0);
+	std::fill(settling_steps.begin(), settling_steps.end(), 0);
+	num_awake = awake.size();
+	beginStep();
+}
+
+/* ******************************************************************************************** */
+void SleepTiles::beginStep() {
+	active.clear();
+	active_ranges.clear();
+	active_links.clear();
+	for(int ty = 0; ty < num_tiles_height; ty++) {
+		for(int tx = 0; tx < num_tiles_width; tx++) {
+			uint32_t tile = ty * num_tiles_width + tx;
+			if(!stepped[tile]) continue;
+
+			// The rows of a tile right after the last one continue its ranges
+			int x0, x1, y0, y1;
+			tileBounds(tile, x0, x1, y0, y1);
+			bool extend = (tx > 0 && !active.empty() && active.back() == tile - 1);
+			size_t first = active_ranges.size() - (extend ? 2 * (y1 - y0) : 0);
+			active.push_back(tile);
+			for(int y = y0; y < y1; y++) {
+				if(extend) active_ranges[first + 2 * (y - y0) + 1] = y * num_particles_width + x1;
+				else {
+					active_ranges.push_back(y * num_particles_width + x0);
+					active_ranges.push_back(y * num_particles_width + x1);
+				}
+			}
+		}
+	}
+
+	// A constraint between a stepped tile and a frozen one still holds the stepped side
+	for(uint32_t l = 0; l < link_tiles.size(); l++)
+		if(stepped[link_tiles[l].first] || stepped[link_tiles[l].second]) active_links.push_back(l);
+}
+
+/* ******************************************************************************************** */
+float SleepTiles::satisfyConstraints(Particles &particles, float stiffness, SimdLevel simd_level) {
+	float max_violation = 0.0f;
+	for(size_t a = 0; a < active_links.size(); a++) {
+		const Constraints &constraints = link_constraints[active_links[a]];
+		max_violation = std::max(max_violation, ::satisfyConstraints(constraints, 0, constraints.size(), particles,
+				stiffness, simd_level));
+	}
+	return max_violation;
+}
+
+/* ******************************************************************************************** */
+bool SleepTiles::isNearAwake(uint32_t tile) const {
+	int tx = tile % num_tiles_width, ty = tile / num_tiles_width;
+	for(int ny = std::max(ty - 1, 0); ny <= std::min(ty + 1, num_tiles_height - 1); ny++)
+		for(int nx = std::max(tx - 1, 0); nx <= std::min(tx + 1, num_tiles_width - 1); nx++)
+			if(awake[ny * num_tiles_width + nx]) return true;
+	return false;
+}
+
+/* ******************************************************************************************** */
+void SleepTiles::endStep(Particles &particles, float damping) {
+	for(size_t a = 0; a < active.size(); a++) {
+		uint32_t tile = active[a];
+
+		// How far the particles moved in this time step
+		int x0, x1, y0, y1;
+		tileBounds(tile, x0, x1, y0, y1);
+		float motion2 = 0.0f;
+		for(int y = y0; y < y1; y++) {
+			for(size_t i = (size_t) y * num_particles_width + x0; i < (size_t) y * num_particles_width + x1; i++) {
+				float mx = particles.x[i] - particles.old_x[i], my = particles.y[i] - particles.old_y[i];
+				float mz = particles.z[i] - particles.old_z[i];
+				motion2 = std::max(motion2, mx * mx + my * my + mz * mz);
+			}
+		}
+
+		// A tile next to one that was just frozen or thawed moves to its new rest without waking anything
+		if(motion2 >= threshold2 && settling_steps[tile] == 0) wakeTile(tile, particles);
+		else if(motion2 >= threshold2) quiet_steps[tile] = 0;
+		else if(awake[tile] && ++quiet_steps[tile] >= sleep_steps) {
+			awake[tile] = 0;
+			num_awake--;
+		}
+		if(settling_steps[tile] > 0) settling_steps[tile]--;
+	}
+
+	// The tiles with no awake neighbor left are frozen where the constraints left them, before the forces of this
+	// time step move them off their rest
+	for(size_t a = 0; a < active.size(); a++) {
+		uint32_t tile = active[a];
+		if(!isNearAwake(tile)) {
+			freeze(tile, particles);
+			continue;
+		}
+		int x0, x1, y0, y1;
+		tileBounds(tile, x0, x1, y0, y1);
+		for(int y = y0; y < y1; y++)
+			particles.timeStep(damping, (size_t) y * num_particles_width + x0, (size_t) y * num_particles_width + x1);
+	}
+}
@@ -0,0 +1,103 @@
+/**
+ * @file SleepTiles.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief Tracks which tiles of the grid of a cloth are moving, so that a time step can skip the ones at rest
+ */
+
+#pragma once
+
+#include "ConstraintKernels.h"
+
+/* Splits the grid of a cloth into square tiles of particles. A tile falls asleep once none of its particles has moved
+ more than a threshold in each of a number of time steps. Only the tiles that are awake or next to an awake one are
+ stepped (their constraints satisfied and their particles integrated), the others are frozen: their particles are
+ pinned where they are, by setting their inverse masses to 0 until they thaw, so that the stepped tiles hang from them
+ and forces do not pile up on them. A sleeping tile next to a moving one is thus still stepped, and wakes up as soon as
+ its neighbor moves one of its particles more than the threshold, which then starts stepping its own neighbors.
+ Collisions wake the tile of each particle they move, see wake(). With the edges of the cloth pinned and a probe pressing
+ on it, only the tiles around the probe stay awake. The threshold has to be above the ripples that freezing a tile
+ sends through its neighbors, more so the more the cloth is stretched, e.g. by gravity. */
+class SleepTiles {
+private:
+	int num_particles_width, num_particles_height;
+	int tile_size;  // particles on a side of a tile
+	int num_tiles_width, num_tiles_height;
+	float threshold2;  // the squared distance a particle has to move in a time step for its tile to be moving
+	int sleep_steps;  // the time steps a tile has to be at rest before it falls asleep
+	std::vector <Constraints> link_constraints;  // the constraints between each pair of tiles, batched
+	std::vector <std::pair <uint32_t, uint32_t> > link_tiles;  // the tiles of the p1 and p2 of each of them
+	std::vector <uint8_t> awake;
+	std::vector <uint8_t> stepped;  // whether each tile was awake or next to an awake one at the last beginStep()
+	std::vector <int> quiet_steps;  // the time steps each awake tile has been at rest for
+	std::vector <int> settling_steps;  // the time steps each tile has left to settle, in which its motion wakes nothing
+	std::vector <uint32_t> active;  // the tiles that are awake or next to an awake one, in order
+	std::vector <uint32_t> active_ranges;  // the particles of the active tiles, as [begin, end) pairs of row segments
+	std::vector <uint32_t> active_links;  // the pairs of tiles with at least one active tile
+	size_t num_awake;
+	std::vector <float> inv_mass;  // the inverse masses of the particles of the frozen tiles
+
+	/* The columns [x0, x1) and rows [y0, y1) of the tile */
+	void tileBounds(uint32_t tile, int &x0, int &x1, int &y0, int &y1) const;
+
+	uint32_t tileOf(uint32_t particle) const {
+		return ((particle / num_particles_width) / tile_size) * num_tiles_width + (particle % num_particles_width) / tile_size;
+	}
+
+	/* Stops and pins the particles of the tile, and drops their forces */
+	void freeze(uint32_t tile, Particles &particles);
+
+	/* Gives the particles of a frozen tile their inverse masses back */
+	void thaw(uint32_t tile, Particles &particles);
+
+	/* Lets the tile and its neighbors settle after the tile was frozen or thawed: pinning or releasing a tile moves the
+	 rest of the tiles next to it a little, which should not wake them and thaw theirs in turn */
+	void settle(uint32_t tile);
+
+	/* Wakes the tile and thaws its neighbors */
+	void wakeTile(uint32_t tile, Particles &particles);
+
+	/* Whether the tile or one of its neighbors is awake */
+	bool isNearAwake(uint32_t tile) const;
+
+public:
+
+	/* Splits the grid into tiles of tile_size x tile_size particles, all of them awake, and sorts the constraints by
+	 the tiles they link. A tile is at rest in a time step if none of its particles moved more than threshold. */
+	SleepTiles(const Constraints &constraints, const Particles &particles, int num_particles_width,
+			int num_particles_height, int tile_size, float threshold, int sleep_steps);
+
+	int getTileSize() const { return tile_size; }
+	float getThreshold() const { return sqrtf(threshold2); }
+	int getSleepSteps() const { return sleep_steps; }
+	size_t numTiles() const { return awake.size(); }
+	size_t numAwake() const { return num_awake; }
+	size_t numStepped() const { return active.size(); }
+	bool isAwake(int x, int y) const { return awake[(y / tile_size) * num_tiles_width + x / tile_size] != 0; }
+
+	/* The inverse mass of the particle, also while its tile is frozen */
+	float getInvMass(uint32_t particle, const Particles &particles) const {
+		return stepped[tileOf(particle)] ? particles.inv_mass[particle] : inv_mass[particle];
+	}
+
+	/* Lists the tiles to step, the ones that are not frozen. Called at the start of a time step. */
+	void beginStep();
+
+	/* Satisfies the constraints that have a particle in an active tile once, returns the largest violation among them */
+	float satisfyConstraints(Particles &particles, float stiffness, SimdLevel simd_level);
+
+	/* Puts the tiles that have been at rest long enough to sleep and wakes the sleeping ones that their neighbors
+	 moved, then freezes the tiles with no awake neighbor left and integrates the others. Called at the end of a time
+	 step, in place of Particles::timeStep(). */
+	void endStep(Particles &particles, float damping);
+
+	/* Wakes the tile of the particle, e.g. when a collision is about to move it. It is movable again right away. */
+	void wake(uint32_t particle, Particles &particles) { wakeTile(tileOf(particle), particles); }
+
+	/* Wakes and thaws all the tiles, when the cloth is stepped without them */
+	void wakeAll(Particles &particles);
+
+	/* The particles of the tiles of the last beginStep(), as [begin, end) pairs. The particles of the other tiles have
+	 not moved since. */
+	const std::vector <uint32_t>& getActiveRanges() const { return active_ranges; }
+};
@@ -0,0 +1,45 @@
+/**
+ * @file SpscQueue.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief A bounded lock-free queue from one producer thread to one consumer thread
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+/* A ring of N items (a power of two) that one thread pushes to and another pops from, without locks */
+template <class T, size_t N>
+class SpscQueue {
+private:
+	static_assert((N & (N - 1)) == 0, "the size of the queue must be a power of two");
+
+	T items[N];
+	std::atomic <size_t> head;  // the next item to pop, only moved by the consumer
+	char padding[64];  // keeps the two ends on different cache lines
+	std::atomic <size_t> tail;  // the next item to push to, only moved by the producer
+
+public:
+
+	SpscQueue() : head(0), tail(0) {}
+
+	/* Adds the item at the end, returns false if the queue is full */
+	bool push(const T &item) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if(t - head.load(std::memory_order_acquire) == N) return false;
+		items[t & (N - 1)] = item;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	/* Takes the first item, returns false if the queue is empty */
+	bool pop(T &item) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if(h == tail.load(std::memory_order_acquire)) return false;
+		item = items[h & (N - 1)];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+};
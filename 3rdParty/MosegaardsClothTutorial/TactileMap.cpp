@@ -0,0 +1,48 @@
+/**
+ * @file TactileMap.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "TactileMap.h"
+
+#include <string.h>
+
+/* ******************************************************************************************** */
+TactileMap::TactileMap(const TactileMap &other) : width(0), height(0), stride(0), base(0), frame(0) {
+	*this = other;
+}
+
+/* ******************************************************************************************** */
+TactileMap& TactileMap::operator=(const TactileMap &other) {
+	if(this == &other) return *this;
+	resize(other.width, other.height);
+	if(!buffer.empty()) memcpy(&buffer[base], &other.buffer[other.base], NUM_CHANNELS * stride * height * sizeof(float));
+	touched = other.touched;
+	frame = other.frame;
+	return *this;
+}
+
+/* ******************************************************************************************** */
+void TactileMap::resize(int width, int height) {
+	this->width = width;
+	this->height = height;
+	stride = (width + 15) / 16 * 16;
+
+	// The extra 15 floats leave room to skip to the first 64-byte boundary
+	buffer.assign(NUM_CHANNELS * stride * height + 15, 0.0f);
+	base = ((64 - (uintptr_t) &buffer[0] % 64) % 64) / sizeof(float);
+	touched.clear();
+	touched.reserve(width * height);
+	frame = 0;
+}
+
+/* ******************************************************************************************** */
+void TactileMap::beginFrame() {
+	for(size_t i = 0; i < touched.size(); i++)
+		for(int c = 0; c < NUM_CHANNELS; c++)
+			buffer[base + c * stride * height + touched[i]] = 0.0f;
+	touched.clear();
+	frame++;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file TactileMap.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief The tactile image of the cloth: what each particle felt in the collisions of a frame
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/* A read-only view of one channel of the tactile image: the value at column x and row y is data[y * stride + x].
+ It points into the buffer of the TactileMap, so it is valid until the next collision stage overwrites it. */
+struct TactileView {
+	const float *data;
+	int width, height;
+	size_t stride;  // the number of floats between two rows
+
+	float at(int x, int y) const { return data[y * stride + x]; }
+};
+
+/* A width x height image, one pixel per particle, with a channel per quantity. The rows are padded to 64 bytes and
+ start on 64-byte boundaries (the buffer is allocated with room to skip to the first one), so a row never shares a
+ cache line with another. The buffer is allocated once; each frame only clears the pixels the previous frame touched. */
+class TactileMap {
+public:
+
+	/* The channels of the image */
+	enum Channel {
+		PENETRATION = 0,  // how deep the particle was inside the shapes (the deepest if there are several)
+		FORCE,  // the normal force the shapes applied, mass * correction / TIME_STEPSIZE2 summed over the shapes
+		CONTACT,  // 1 if the particle touched a shape, 0 otherwise
+		NUM_CHANNELS
+	};
+
+private:
+	int width, height;
+	size_t stride;  // floats per row
+	std::vector <float> buffer;  // the channels one after the other, from buffer[base]
+	size_t base;  // the first float of the buffer on a 64-byte boundary
+	std::vector <uint32_t> touched;  // the pixels set in this frame, from the start of a channel
+	unsigned long frame;  // the number of frames recorded
+
+public:
+
+	TactileMap() : width(0), height(0), stride(0), base(0), frame(0) {}
+
+	/* A copy has its own 64-byte boundary, which may not be at the same offset in its buffer */
+	TactileMap(const TactileMap &other);
+	TactileMap& operator=(const TactileMap &other);
+
+	/* Sizes the image for a width x height grid of particles, clearing it */
+	void resize(int width, int height);
+
+	/* Starts a new frame, clearing the pixels of the last one */
+	void beginFrame();
+
+	/* Records that the particle at column x and row y was pushed by a shape */
+	void record(int x, int y, float penetration, float force) {
+		size_t pixel = y * stride + x;
+		float *contact = &buffer[base + CONTACT * stride * height + pixel];
+		if(*contact == 0.0f) {
+			*contact = 1.0f;
+			touched.push_back(pixel);
+		}
+		float &depth = buffer[base + PENETRATION * stride * height + pixel];
+		if(penetration > depth) depth = penetration;
+		buffer[base + FORCE * stride * height + pixel] += force;
+	}
+
+	TactileView view(Channel channel) const {
+		TactileView view = {&buffer[base] + channel * stride * height, width, height, stride};
+		return view;
+	}
+
+	/* The number of particles that touched a shape in the current frame */
+	size_t numContacts() const { return touched.size(); }
+	unsigned long getFrame() const { return frame; }
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+};
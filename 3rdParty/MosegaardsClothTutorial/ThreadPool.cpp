@@ -0,0 +1,111 @@
+/**
+ * @file ThreadPool.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "ThreadPool.h"
+
+/* The tasks [front, back) a thread has not started yet, packed into one word so that taking one from either end
+ is a single compare and swap */
+struct TaskRange {
+	std::atomic <uint64_t> range;  // back << 32 | front
+	uint64_t padding[7];  // a cache line per thread
+
+	/* Takes the task at the front (for the owner) or at the back (for a thief) */
+	bool take(bool from_front, size_t &task) {
+		uint64_t current = range.load(std::memory_order_relaxed);
+		while(true) {
+			uint32_t front = (uint32_t) current, back = (uint32_t) (current >> 32);
+			if(front >= back) return false;
+			uint64_t taken = from_front ? ((uint64_t) back << 32 | (front + 1)) : ((uint64_t) (back - 1) << 32 | front);
+			if(range.compare_exchange_weak(current, taken, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+				task = from_front ? front : back - 1;
+				return true;
+			}
+		}
+	}
+};
+
+/* ******************************************************************************************** */
+ThreadPool::ThreadPool(int num_threads) : job(NULL), generation(0), pending(0), stop(false) {
+	if(num_threads <= 0) num_threads = std::max(1u, std::thread::hardware_concurrency());
+	for(int i = 1; i < num_threads; i++)
+		workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+}
+
+/* ******************************************************************************************** */
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard <std::mutex> lock(mutex);
+		stop = true;
+	}
+	start_signal.notify_all();
+	for(size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+/* ******************************************************************************************** */
+void ThreadPool::run(const std::function <void(int, int)> &job) {
+	if(workers.empty()) {
+		job(0, 1);
+		return;
+	}
+
+	// Wake up the workers and do our share
+	{
+		std::lock_guard <std::mutex> lock(mutex);
+		this->job = &job;
+		pending = (int) workers.size();
+		generation++;
+	}
+	start_signal.notify_all();
+	job(0, size());
+
+	// Wait for the rest
+	std::unique_lock <std::mutex> lock(mutex);
+	done_signal.wait(lock, [this]() {return pending == 0;});
+	this->job = NULL;
+}
+
+/* ******************************************************************************************** */
+void ThreadPool::workerLoop(int thread) {
+	unsigned long seen = 0;
+	while(true) {
+		const std::function <void(int, int)> *current;
+		{
+			std::unique_lock <std::mutex> lock(mutex);
+			start_signal.wait(lock, [&]() {return stop || generation != seen;});
+			if(stop) return;
+			seen = generation;
+			current = job;
+		}
+		(*current)(thread, size());
+		{
+			std::lock_guard <std::mutex> lock(mutex);
+			if(--pending == 0) done_signal.notify_one();
+		}
+	}
+}
+
+/* ******************************************************************************************** */
+void ThreadPool::runTasks(size_t num_tasks, const std::function <void(size_t, int)> &task) {
+	std::vector <TaskRange> ranges(size());
+	for(int t = 0; t < size(); t++) {
+		uint64_t front = splitPoint(0, num_tasks, t, size(), 1), back = splitPoint(0, num_tasks, t + 1, size(), 1);
+		ranges[t].range.store(back << 32 | front, std::memory_order_relaxed);
+	}
+	run([&](int thread, int num_threads) {
+		size_t i;
+		while(ranges[thread].take(true, i))
+			task(i, thread);
+
+		// The shares only shrink, so one pass over the others finds all the tasks that are left
+		for(int k = 1; k < num_threads; k++) {
+			int victim = (thread + k) % num_threads;
+			while(ranges[victim].take(false, i))
+				task(i, thread);
+		}
+	});
+}
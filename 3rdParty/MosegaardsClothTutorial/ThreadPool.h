@@ -0,0 +1,78 @@
+/**
+ * @file ThreadPool.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief A fixed set of worker threads that run one job together or share a set of tasks, and a barrier to synchronize them
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Runs a job on all of its threads at once: the job is called as job(thread, num_threads) with the calling
+ thread as thread 0, and run() returns once every thread has finished it. The threads of a job synchronize
+ between phases with a SpinBarrier. */
+class ThreadPool {
+private:
+	std::vector <std::thread> workers;  // threads 1 to num_threads-1
+	std::mutex mutex;
+	std::condition_variable start_signal, done_signal;
+	const std::function <void(int, int)> *job;  // the job being run
+	unsigned long generation;  // increases every time a job is started
+	int pending;  // the number of workers still running the job
+	bool stop;
+
+	void workerLoop(int thread);
+
+public:
+
+	/* Creates num_threads - 1 workers, 0 picks the number of cores */
+	explicit ThreadPool(int num_threads = 0);
+	~ThreadPool();
+
+	int size() const { return (int) workers.size() + 1; }
+
+	void run(const std::function <void(int, int)> &job);
+
+	/* Runs task(i, thread) for every i in [0, num_tasks) on the threads, for tasks that take very different times.
+	 Each thread starts with a consecutive share of the tasks and takes them from the front; once it is out of tasks it
+	 steals from the back of the shares of the others. Returns once all the tasks are done. */
+	void runTasks(size_t num_tasks, const std::function <void(size_t, int)> &task);
+};
+
+/* A reusable barrier for the threads of a ThreadPool job. The threads spin (yielding) rather than sleep,
+ since the phases between two barriers are short. */
+class SpinBarrier {
+private:
+	const int num_threads;
+	std::atomic <int> waiting;
+	std::atomic <unsigned> phase;
+
+public:
+	explicit SpinBarrier(int num_threads) : num_threads(num_threads), waiting(0), phase(0) {}
+
+	void wait() {
+		unsigned current = phase.load(std::memory_order_acquire);
+		if(waiting.fetch_add(1, std::memory_order_acq_rel) == num_threads - 1) {
+			waiting.store(0, std::memory_order_relaxed);
+			phase.fetch_add(1, std::memory_order_release);
+			return;
+		}
+		for(int spins = 0; phase.load(std::memory_order_acquire) == current; spins++)
+			if(spins > 64) std::this_thread::yield();
+	}
+};
+
+/* Splits [begin, end) into num_parts consecutive ranges, part k being [splitPoint(k), splitPoint(k + 1)).
+ The inner boundaries are multiples of align so that the batches of the vectorized kernels stay whole. */
+inline size_t splitPoint(size_t begin, size_t end, int part, int num_parts, size_t align) {
+	if(part <= 0) return begin;
+	if(part >= num_parts) return end;
+	size_t point = (begin + (end - begin) * part / num_parts) / align * align;
+	return (point < begin) ? begin : point;
+}
@@ -0,0 +1,234 @@
+/**
+ * @file Trajectory.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "Trajectory.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char TRAJECTORY_MAGIC[8] = {'C', 'L', 'O', 'T', 'H', 'T', 'R', 'J'};
+static const uint32_t TRAJECTORY_VERSION = 1;
+
+/* ******************************************************************************************** */
+TrajectoryWriter::TrajectoryWriter() : file(NULL), next(0), stop(false), failed(false) {
+	memset(&header, 0, sizeof(header));
+	full[0] = full[1] = false;
+}
+
+/* ******************************************************************************************** */
+bool TrajectoryWriter::open(const char *path, const Cloth &cloth, unsigned flags) {
+	close();
+	file = fopen(path, "wb");
+	if(file == NULL) return false;
+
+	// The header is written again with the number of frames and the index when closing
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+	header.version = TRAJECTORY_VERSION;
+	header.flags = flags;
+	header.width = cloth.getNumParticlesWidth();
+	header.height = cloth.getNumParticlesHeight();
+	header.topology_hash = cloth.getConstraints().topologyHash();
+	size_t num_arrays = 3 + ((flags & TRAJECTORY_CONTACTS) ? TactileMap::NUM_CHANNELS : 0) + ((flags & TRAJECTORY_NORMALS) ? 3 : 0);
+	header.frame_size = sizeof(uint64_t) + num_arrays * cloth.getParticles().size() * sizeof(float);
+	if(fwrite(&header, sizeof(header), 1, file) != 1) {
+		fclose(file);
+		file = NULL;
+		return false;
+	}
+
+	index.clear();
+	for(int b = 0; b < 2; b++) {
+		buffers[b].resize(header.frame_size);
+		full[b] = false;
+	}
+	next = 0;
+	stop = false;
+	failed = false;
+	thread = std::thread(&TrajectoryWriter::writerLoop, this);
+	return true;
+}
+
+/* ******************************************************************************************** */
+void TrajectoryWriter::writerLoop() {
+	int current = 0;
+	while(true) {
+		{
+			std::unique_lock <std::mutex> lock(mutex);
+			signal.wait(lock, [&] { return full[current] || stop; });
+			if(!full[current]) return;  // stopped and nothing left to write
+		}
+
+		// The buffer is not touched by write() until it is marked empty again
+		if(fwrite(&buffers[current][0], buffers[current].size(), 1, file) != 1) failed = true;
+
+		{
+			std::lock_guard <std::mutex> lock(mutex);
+			full[current] = false;
+		}
+		signal.notify_all();
+		current ^= 1;
+	}
+}
+
+/* ******************************************************************************************** */
+void TrajectoryWriter::write(Cloth &cloth) {
+	if(file == NULL) return;
+	const Particles &particles = cloth.getParticles();
+	size_t num_particles = particles.size();
+	if(num_particles * 3 * sizeof(float) + sizeof(uint64_t) > header.frame_size) return;  // not the cloth of open()
+	if(header.flags & TRAJECTORY_NORMALS) cloth.computeNormals();
+
+	// Wait for the thread to be done with the buffer it had two frames ago
+	{
+		std::unique_lock <std::mutex> lock(mutex);
+		signal.wait(lock, [&] { return !full[next]; });
+	}
+
+	char *out = &buffers[next][0];
+	uint64_t number = header.num_frames;
+	memcpy(out, &number, sizeof(number));
+	out += sizeof(number);
+	size_t array_size = num_particles * sizeof(float);
+	const std::vector <float> *arrays[] = {&particles.x, &particles.y, &particles.z};
+	for(int a = 0; a < 3; a++, out += array_size)
+		memcpy(out, &(*arrays[a])[0], array_size);
+
+	// The tactile channels lose the padding of their rows
+	if(header.flags & TRAJECTORY_CONTACTS) {
+		for(int channel = 0; channel < TactileMap::NUM_CHANNELS; channel++) {
+			TactileView view = cloth.getTactileView((TactileMap::Channel) channel);
+			for(int y = 0; y < view.height; y++, out += view.width * sizeof(float))
+				memcpy(out, view.data + y * view.stride, view.width * sizeof(float));
+		}
+	}
+
+	if(header.flags & TRAJECTORY_NORMALS) {
+		const std::vector <float> *normals[] = {&particles.normal_x, &particles.normal_y, &particles.normal_z};
+		for(int a = 0; a < 3; a++, out += array_size)
+			memcpy(out, &(*normals[a])[0], array_size);
+	}
+
+	index.push_back(sizeof(TrajectoryHeader) + header.num_frames * header.frame_size);
+	header.num_frames++;
+	{
+		std::lock_guard <std::mutex> lock(mutex);
+		full[next] = true;
+	}
+	signal.notify_all();
+	next ^= 1;
+}
+
+/* ******************************************************************************************** */
+bool TrajectoryWriter::close() {
+	if(file == NULL) return true;
+	{
+		std::lock_guard <std::mutex> lock(mutex);
+		stop = true;
+	}
+	signal.notify_all();
+	thread.join();
+
+	// The index goes after the last frame and the header is patched to point at it
+	header.index_offset = sizeof(TrajectoryHeader) + header.num_frames * header.frame_size;
+	bool ok = !failed;
+	if(!index.empty() && fwrite(&index[0], sizeof(uint64_t), index.size(), file) != index.size()) ok = false;
+	if(fseek(file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, file) != 1) ok = false;
+	if(fclose(file) != 0) ok = false;
+	file = NULL;
+	return ok;
+}
+
+/* ******************************************************************************************** */
+bool TrajectoryReader::open(const char *path) {
+	close();
+	int fd = ::open(path, O_RDONLY);
+	if(fd < 0) return false;
+	struct stat info;
+	if(fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(TrajectoryHeader)) {
+		::close(fd);
+		return false;
+	}
+	void *mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(mapped == MAP_FAILED) return false;
+	data = (const char *) mapped;
+	size = info.st_size;
+
+	memcpy(&header, data, sizeof(header));
+	if(memcmp(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic)) != 0 || header.version != TRAJECTORY_VERSION
+			|| header.width <= 0 || header.height <= 0) {
+		close();
+		return false;
+	}
+
+	// A frame is its number and the arrays of the flags, which bounds the grid before it is multiplied out
+	uint64_t num_arrays = 3 + ((header.flags & TRAJECTORY_CONTACTS) ? TactileMap::NUM_CHANNELS : 0) +
+			((header.flags & TRAJECTORY_NORMALS) ? 3 : 0);
+	uint64_t num_particles = (uint64_t) header.width * (uint64_t) header.height;
+	if(num_particles > size / (num_arrays * sizeof(float))
+			|| header.frame_size != sizeof(uint64_t) + num_arrays * num_particles * sizeof(float)) {
+		close();
+		return false;
+	}
+
+	// Without an index the writer did not get to close the file: keep the whole frames that made it to the disk
+	index.clear();
+	if(header.index_offset != 0 && header.index_offset <= size
+			&& header.num_frames <= (size - header.index_offset) / sizeof(uint64_t)) {
+		index.resize(header.num_frames);
+		if(!index.empty()) memcpy(&index[0], data + header.index_offset, index.size() * sizeof(uint64_t));
+		for(size_t i = 0; i < index.size(); i++) {
+			if(index[i] < sizeof(TrajectoryHeader) || index[i] > size || header.frame_size > size - index[i]) {
+				close();
+				return false;
+			}
+		}
+	}
+	else header.num_frames = (size - sizeof(TrajectoryHeader)) / header.frame_size;
+	return true;
+}
+
+/* ******************************************************************************************** */
+void TrajectoryReader::close() {
+	if(data != NULL) munmap((void *) data, size);
+	data = NULL;
+	size = 0;
+	index.clear();
+}
+
+/* ******************************************************************************************** */
+TrajectoryFrame TrajectoryReader::frame(uint64_t i) const {
+	TrajectoryFrame frame;
+	memset(&frame, 0, sizeof(frame));
+	if(data == NULL || i >= header.num_frames) return frame;
+
+	uint64_t offset = !index.empty() ? index[i] : sizeof(TrajectoryHeader) + i * header.frame_size;
+	const char *in = data + offset;
+	memcpy(&frame.number, in, sizeof(frame.number));
+	const float *arrays = (const float *) (in + sizeof(uint64_t));
+	size_t n = (size_t) header.width * header.height;
+	frame.x = arrays;
+	frame.y = arrays + n;
+	frame.z = arrays + 2 * n;
+	arrays += 3 * n;
+	if(header.flags & TRAJECTORY_CONTACTS) {
+		frame.penetration = arrays;
+		frame.force = arrays + n;
+		frame.contact = arrays + 2 * n;
+		arrays += 3 * n;
+	}
+	if(header.flags & TRAJECTORY_NORMALS) {
+		frame.normal_x = arrays;
+		frame.normal_y = arrays + n;
+		frame.normal_z = arrays + 2 * n;
+	}
+	return frame;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file Trajectory.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief Recording the frames of a cloth to a binary file and reading them back
+ *
+ * The file is a 64 byte header, the frames one after the other, and an index with the offset of each
+ * frame at the end (found through the header). A frame is its uint64 frame number followed by float arrays of
+ * num_particles each: x, y, z, then optionally the penetration, force and contact channels of the tactile map,
+ * then optionally the normals x, y, z. All the values are in the byte order of the machine that wrote them.
+ */
+
+#pragma once
+
+#include "Cloth.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+/* What is recorded in addition to the positions */
+enum TrajectoryFlags {
+	TRAJECTORY_CONTACTS = 1,  // the channels of the tactile map
+	TRAJECTORY_NORMALS = 2  // the particle normals
+};
+
+/* The header at the start of a trajectory file */
+struct TrajectoryHeader {
+	char magic[8];  // "CLOTHTRJ"
+	uint32_t version;
+	uint32_t flags;  // TrajectoryFlags
+	int32_t width, height;  // the particles of the cloth
+	uint64_t topology_hash;  // Constraints::topologyHash() of the cloth
+	uint64_t num_frames;
+	uint64_t index_offset;  // where the index is, 0 if the file was not closed
+	uint64_t frame_size;  // the bytes of a frame
+	uint8_t reserved[8];
+};
+
+/* Appends frames of a cloth to a file. write() copies the frame into one of two buffers and hands it over to a
+ background thread that writes it out, so the simulation only waits if the disk falls behind by a whole frame. */
+class TrajectoryWriter {
+private:
+	FILE *file;
+	TrajectoryHeader header;
+	std::vector <uint64_t> index;  // the offsets of the frames written so far
+	std::vector <char> buffers[2];  // a frame being filled by write() while the other is written out
+	bool full[2];  // whether a buffer holds a frame the thread has not written yet
+	int next;  // the buffer write() fills next
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable signal;
+	bool stop;
+	bool failed;  // set by the thread if a write failed
+
+	void writerLoop();
+
+public:
+
+	TrajectoryWriter();
+	~TrajectoryWriter() { close(); }
+
+	/* Creates the file for frames of the cloth, with the given TrajectoryFlags. Returns false if it cannot. */
+	bool open(const char *path, const Cloth &cloth, unsigned flags);
+
+	/* Appends the current state of the cloth, computing its normals if they are recorded */
+	void write(Cloth &cloth);
+
+	/* Waits for the frames to be written, adds the index and closes the file. Returns false if any write failed. */
+	bool close();
+
+	uint64_t numFrames() const { return header.num_frames; }
+};
+
+/* A frame of a trajectory file, pointing into the mapped file. The arrays that were not recorded are NULL. */
+struct TrajectoryFrame {
+	uint64_t number;
+	const float *x, *y, *z;
+	const float *penetration, *force, *contact;  // width x height images without padding
+	const float *normal_x, *normal_y, *normal_z;
+};
+
+/* Maps a trajectory file into memory so that any frame can be read without loading the whole run. A file
+ whose writer did not close it can still be read up to its last whole frame. */
+class TrajectoryReader {
+private:
+	const char *data;  // the mapped file
+	size_t size;
+	TrajectoryHeader header;
+	std::vector <uint64_t> index;  // empty if the file was not closed, the frames are then found by their size
+
+public:
+
+	TrajectoryReader() : data(NULL), size(0) {}
+	~TrajectoryReader() { close(); }
+
+	/* Maps the file, returns false if it cannot or it is not a trajectory: the size of a frame has to match the grid
+	 and the arrays of the header, and the index has to fit in the file with every frame it points to */
+	bool open(const char *path);
+	void close();
+
+	const TrajectoryHeader& getHeader() const { return header; }
+	uint64_t numFrames() const { return header.num_frames; }
+
+	/* The i'th frame of the file */
+	TrajectoryFrame frame(uint64_t i) const;
+};
@@ -0,0 +1,24 @@
+# Records a trajectory with ClothHeadless and checks it with TrajectoryTest, for the tests of CMakeLists.txt:
+#   cmake -DHEADLESS=<ClothHeadless> -DCHECK=<TrajectoryTest> -DSCENE="<options>" -DFRAMES=<n> -DFRAME=<i> -DDIR=<dir>
+#     -P TrajectoryTest.cmake
+# A second run stops after frame FRAME (counted from 0), whose positions the frame of the trajectory has to match.
+
+separate_arguments(scene UNIX_COMMAND "${SCENE}")
+math(EXPR stop "${FRAME} + 1")
+
+execute_process(COMMAND ${HEADLESS} ${scene} -f ${FRAMES} -o ${DIR}/trajectory.bin -w ${DIR}/trajectory_last.bin
+  RESULT_VARIABLE result OUTPUT_QUIET)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "Recording the trajectory failed (${result})")
+endif()
+
+execute_process(COMMAND ${HEADLESS} ${scene} -f ${stop} -w ${DIR}/trajectory_frame.bin RESULT_VARIABLE result OUTPUT_QUIET)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "The run stopping after frame ${FRAME} failed (${result})")
+endif()
+
+execute_process(COMMAND ${CHECK} ${DIR}/trajectory.bin ${FRAMES} ${DIR}/trajectory_last.bin ${FRAME}
+  ${DIR}/trajectory_frame.bin RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "The trajectory does not read back (${result})")
+endif()
@@ -0,0 +1,147 @@
+/**
+ * @file TrajectoryTest.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief Checks that a trajectory recorded by ClothHeadless -o reads back through TrajectoryReader, also once it is
+ * cut short or its writer did not close it, for the tests of CMakeLists.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "ClothState.h"
+#include "Trajectory.h"
+
+/* ******************************************************************************************** */
+void usage(const char *name) {
+	printf("Usage: %s <trajectory> <frames> <state> <frame> <frame state>\n", name);
+	printf("  <trajectory>      the file recorded by ClothHeadless -o, damaged copies of it are written next to it\n");
+	printf("  <frames>          the number of frames it has to have\n");
+	printf("  <state>           the state saved with -w by the same run, after its last frame\n");
+	printf("  <frame>           a frame, counted from 0\n");
+	printf("  <frame state>     the state saved by a run of the same scene that stopped after that frame\n");
+}
+
+/* ******************************************************************************************** */
+/* Whether the positions of the frame are those of the state, to the bit */
+bool samePositions(const TrajectoryFrame &frame, const ClothState &state) {
+	size_t n = state.numParticles();
+	return frame.x != NULL && !memcmp(frame.x, &state.x[0], n * sizeof(float))
+			&& !memcmp(frame.y, &state.y[0], n * sizeof(float)) && !memcmp(frame.z, &state.z[0], n * sizeof(float));
+}
+
+/* ******************************************************************************************** */
+/* Whether the frame is the same frame of the original file, to the bit */
+bool sameFrame(const TrajectoryReader &reader, const TrajectoryReader &original, uint64_t i) {
+	TrajectoryFrame a = reader.frame(i), b = original.frame(i);
+	size_t bytes = original.getHeader().frame_size - sizeof(uint64_t);
+	return a.x != NULL && a.number == b.number && !memcmp(a.x, b.x, bytes);
+}
+
+/* ******************************************************************************************** */
+/* Writes the header and the first size bytes after it of the original file to path */
+bool writeCopy(const std::string &path, const std::string &original, const TrajectoryHeader &header, size_t size) {
+	FILE *in = fopen(original.c_str(), "rb");
+	if(in == NULL) return false;
+	std::string bytes(size, '\0');
+	bool ok = fseek(in, sizeof(TrajectoryHeader), SEEK_SET) == 0 && fread(&bytes[0], 1, size, in) == size;
+	fclose(in);
+	FILE *out = fopen(path.c_str(), "wb");
+	if(out == NULL) return false;
+	ok = ok && fwrite(&header, sizeof(header), 1, out) == 1 && fwrite(bytes.data(), 1, size, out) == size;
+	return (fclose(out) == 0) && ok;
+}
+
+/* ******************************************************************************************** */
+int main(int argc, char** argv) {
+	if(argc != 6) {
+		usage(argv[0]);
+		return 1;
+	}
+	std::string path = argv[1];
+	uint64_t num_frames = strtoull(argv[2], NULL, 10), frame = strtoull(argv[4], NULL, 10);
+	ClothState last, middle;
+	if(!last.load(argv[3]) || !middle.load(argv[5])) {
+		fprintf(stderr, "Could not read the states %s and %s\n", argv[3], argv[5]);
+		return 1;
+	}
+
+	// The closed file has every frame, in order, at the positions the runs ended with
+	TrajectoryReader original;
+	if(!original.open(path.c_str())) {
+		fprintf(stderr, "Could not open the trajectory %s\n", path.c_str());
+		return 1;
+	}
+	const TrajectoryHeader header = original.getHeader();
+	int failures = 0;
+	if(original.numFrames() != num_frames) {
+		fprintf(stderr, "%lu frames instead of %lu\n", (unsigned long) original.numFrames(), (unsigned long) num_frames);
+		failures++;
+	}
+	if(header.width != last.num_particles_width || header.height != last.num_particles_height) {
+		fprintf(stderr, "The grid is %dx%d instead of %dx%d\n", header.width, header.height, last.num_particles_width,
+				last.num_particles_height);
+		return 1;
+	}
+	for(uint64_t i = 0; i < original.numFrames(); i++) {
+		if(original.frame(i).number != i) {
+			fprintf(stderr, "Frame %lu is numbered %lu\n", (unsigned long) i, (unsigned long) original.frame(i).number);
+			failures++;
+		}
+	}
+	if(!samePositions(original.frame(num_frames - 1), last)) {
+		fprintf(stderr, "The last frame is not the final state\n");
+		failures++;
+	}
+	if(frame >= num_frames || !samePositions(original.frame(frame), middle)) {
+		fprintf(stderr, "Frame %lu is not the state of the run that stopped there\n", (unsigned long) frame);
+		failures++;
+	}
+
+	// A writer that did not close the file left the header of open() and half a frame: the whole frames are read
+	std::string damaged = path + ".damaged";
+	TrajectoryHeader unclosed = header;
+	unclosed.num_frames = 0;
+	unclosed.index_offset = 0;
+	TrajectoryReader reader;
+	uint64_t kept = num_frames / 2;
+	if(!writeCopy(damaged, path, unclosed, kept * header.frame_size + header.frame_size / 2)
+			|| !reader.open(damaged.c_str()) || reader.numFrames() != kept || !sameFrame(reader, original, kept - 1)) {
+		fprintf(stderr, "An unclosed file does not read back its %lu whole frames\n", (unsigned long) kept);
+		failures++;
+	}
+
+	// A closed file cut short, in its frames or in its index, loses the index and falls back to the whole frames
+	size_t cuts[] = {kept * header.frame_size + 4, num_frames * header.frame_size + 4};
+	for(int c = 0; c < 2; c++) {
+		uint64_t whole = cuts[c] / header.frame_size;
+		if(!writeCopy(damaged, path, header, cuts[c]) || !reader.open(damaged.c_str()) || reader.numFrames() != whole
+				|| !sameFrame(reader, original, whole - 1)) {
+			fprintf(stderr, "A closed file cut after %lu bytes does not read back its %lu whole frames\n",
+					(unsigned long) cuts[c], (unsigned long) whole);
+			failures++;
+		}
+	}
+
+	// A header that does not match its frames, or that is cut short itself, is not a trajectory
+	TrajectoryHeader wrong = header;
+	wrong.frame_size += sizeof(float);
+	if(!writeCopy(damaged, path, wrong, num_frames * header.frame_size) || reader.open(damaged.c_str())) {
+		fprintf(stderr, "A frame size that does not match the grid is accepted\n");
+		failures++;
+	}
+	FILE *cut = fopen(damaged.c_str(), "wb");
+	if(cut == NULL || fwrite(&header, sizeof(header) / 2, 1, cut) != 1 || fclose(cut) != 0
+			|| reader.open(damaged.c_str())) {
+		fprintf(stderr, "A file shorter than the header is accepted\n");
+		failures++;
+	}
+	reader.close();
+	remove(damaged.c_str());
+
+	printf("%s: %lu frames of %dx%d, %d failures\n", path.c_str(), (unsigned long) num_frames, header.width, header.height,
+			failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,338 @@
+/**
+ * @file TriangleMesh.cpp
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief
+ */
+
+#include "TriangleMesh.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+/* ******************************************************************************************** */
+/* Splits the polygon of corners into a fan of triangles, false if a corner is not a vertex. The triangles with a
+ repeated corner (e.g. f 5 5 6, common in scanned and exported meshes) are dropped, they have no area. */
+static bool addPolygon(const std::vector <long> &corners, size_t num_vertices, std::vector <uint32_t> &triangles) {
+	for(size_t c = 0; c < corners.size(); c++)
+		if(corners[c] < 0 || (size_t) corners[c] >= num_vertices) return false;
+	for(size_t c = 2; c < corners.size(); c++) {
+		if(corners[0] == corners[c - 1] || corners[0] == corners[c] || corners[c - 1] == corners[c]) continue;
+		triangles.push_back(corners[0]);
+		triangles.push_back(corners[c - 1]);
+		triangles.push_back(corners[c]);
+	}
+	return true;
+}
+
+/* ******************************************************************************************** */
+bool TriangleMesh::loadOBJ(const char *path) {
+	FILE *file = fopen(path, "r");
+	if(file == NULL) return false;
+	vertices.clear();
+	triangles.clear();
+	char line[1024];
+	bool ok = true;
+	std::vector <long> corners;
+	while(ok && fgets(line, sizeof(line), file) != NULL) {
+		if(line[0] == 'v' && line[1] == ' ') {
+			float x, y, z;
+			ok = (sscanf(line + 2, "%f %f %f", &x, &y, &z) == 3);
+			vertices.push_back(Vec3(x, y, z));
+		}
+		else if(line[0] == 'f' && line[1] == ' ') {
+
+			// Each corner is v, v/vt, v//vn or v/vt/vn, 1-based or negative from the end
+			corners.clear();
+			for(char *token = strtok(line + 2, " \t\r\n"); token != NULL; token = strtok(NULL, " \t\r\n")) {
+				long index = strtol(token, NULL, 10);
+				corners.push_back(index < 0 ? (long) vertices.size() + index : index - 1);
+			}
+			ok = addPolygon(corners, vertices.size(), triangles);
+		}
+	}
+	fclose(file);
+	return ok && !triangles.empty();
+}
+
+/* ******************************************************************************************** */
+/* The bytes of a PLY property type, 0 if it is not one */
+static int plySize(const std::string &type) {
+	if(type == "char" || type == "uchar" || type == "int8" || type == "uint8") return 1;
+	if(type == "short" || type == "ushort" || type == "int16" || type == "uint16") return 2;
+	if(type == "int" || type == "uint" || type == "float" || type == "int32" || type == "uint32" || type == "float32") return 4;
+	if(type == "double" || type == "float64") return 8;
+	return 0;
+}
+
+/* ******************************************************************************************** */
+/* Reads a binary little endian value of the PLY type */
+static double plyValue(const std::string &type, const unsigned char *in) {
+	switch(plySize(type)) {
+	case 1: return (type[0] == 'u') ? (double) in[0] : (double) (int8_t) in[0];
+	case 2: {
+		uint16_t value;
+		memcpy(&value, in, 2);
+		return (type[0] == 'u') ? (double) value : (double) (int16_t) value;
+	}
+	case 4: {
+		if(type[0] == 'f') {
+			float value;
+			memcpy(&value, in, 4);
+			return value;
+		}
+		uint32_t value;
+		memcpy(&value, in, 4);
+		return (type[0] == 'u') ? (double) value : (double) (int32_t) value;
+	}
+	default: {
+		double value;
+		memcpy(&value, in, 8);
+		return value;
+	}
+	}
+}
+
+/* ******************************************************************************************** */
+bool TriangleMesh::loadPLY(const char *path) {
+	struct Property {
+		std::string name, type;
+		std::string count_type;  // of a list, empty otherwise
+	};
+	struct Element {
+		std::string name;
+		size_t count;
+		std::vector <Property> properties;
+	};
+
+	FILE *file = fopen(path, "rb");
+	if(file == NULL) return false;
+	vertices.clear();
+	triangles.clear();
+
+	// The header says what the elements are and how they are stored
+	char line[1024];
+	std::vector <Element> elements;
+	bool binary = false, ok = (fgets(line, sizeof(line), file) != NULL && strncmp(line, "ply", 3) == 0);
+	while(ok) {
+		ok = (fgets(line, sizeof(line), file) != NULL);
+		char word[3][256];
+		unsigned long count;
+		int n = ok ? sscanf(line, "%255s %255s %255s", word[0], word[1], word[2]) : 0;
+		if(n < 1) continue;
+		std::string keyword = word[0];
+		if(keyword == "end_header") break;
+		if(keyword == "format" && n >= 2) {
+			binary = !strcmp(word[1], "binary_little_endian");
+			ok = binary || !strcmp(word[1], "ascii");
+		}
+		else if(keyword == "element" && sscanf(line, "element %255s %lu", word[1], &count) == 2) {
+			Element element = {word[1], (size_t) count, std::vector <Property>()};
+			elements.push_back(element);
+		}
+		else if(keyword == "property" && !elements.empty()) {
+			Property property;
+			char list_type[256], item_type[256], name[256];
+			if(!strcmp(word[1], "list") && sscanf(line, "property list %255s %255s %255s", list_type, item_type, name) == 3) {
+				property.count_type = list_type;
+				property.type = item_type;
+				property.name = name;
+				ok = plySize(list_type) > 0;
+			}
+			else if(n == 3) {
+				property.type = word[1];
+				property.name = word[2];
+			}
+			else ok = false;
+			ok = ok && plySize(property.type) > 0;
+			elements.back().properties.push_back(property);
+		}
+	}
+
+	// The body, as raw bytes or as text
+	std::vector <unsigned char> data;
+	size_t at = 0;
+	if(ok && binary) {
+		long start = ftell(file);
+		ok = (start >= 0 && fseek(file, 0, SEEK_END) == 0);
+		long end = ok ? ftell(file) : -1;
+		ok = ok && end >= start && fseek(file, start, SEEK_SET) == 0;
+		if(ok && end > start) {
+			data.resize(end - start);
+			ok = (fread(&data[0], data.size(), 1, file) == 1);
+		}
+	}
+	std::function <bool(const std::string &, double &)> read = [&](const std::string &type, double &value) {
+		if(!binary) return fscanf(file, "%lf", &value) == 1;
+		size_t size = plySize(type);
+		if(at + size > data.size()) return false;
+		value = plyValue(type, &data[at]);
+		at += size;
+		return true;
+	};
+
+	std::vector <long> corners;
+	for(size_t e = 0; ok && e < elements.size(); e++) {
+		const Element &element = elements[e];
+		for(size_t i = 0; ok && i < element.count; i++) {
+			double position[3] = {0, 0, 0};
+			for(size_t p = 0; ok && p < element.properties.size(); p++) {
+				const Property &property = element.properties[p];
+				double value;
+				if(property.count_type.empty()) {
+					ok = read(property.type, value);
+					if(element.name == "vertex" && property.name.size() == 1 && property.name[0] >= 'x' && property.name[0] <= 'z')
+						position[property.name[0] - 'x'] = value;
+					continue;
+				}
+				double count;
+				ok = read(property.count_type, count);
+				corners.clear();
+				for(long c = 0; ok && c < (long) count; c++) {
+					ok = read(property.type, value);
+					corners.push_back((long) value);
+				}
+				if(ok && element.name == "face" && (property.name == "vertex_indices" || property.name == "vertex_index"))
+					ok = addPolygon(corners, vertices.size(), triangles);
+			}
+			if(element.name == "vertex") vertices.push_back(Vec3(position[0], position[1], position[2]));
+		}
+	}
+	fclose(file);
+	return ok && !triangles.empty();
+}
+
+/* ******************************************************************************************** */
+bool TriangleMesh::load(const char *path) {
+	const char *extension = strrchr(path, '.');
+	if(extension != NULL && (!strcmp(extension, ".ply") || !strcmp(extension, ".PLY"))) return loadPLY(path);
+	return loadOBJ(path);
+}
+
+/* ******************************************************************************************** */
+/* Spreads the lower 10 bits of v to every third bit */
+static inline uint32_t spreadBits(uint32_t v) {
+	v = (v | (v << 16)) & 0x030000FF;
+	v = (v | (v << 8)) & 0x0300F00F;
+	v = (v | (v << 4)) & 0x030C30C3;
+	v = (v | (v << 2)) & 0x09249249;
+	return v;
+}
+
+/* ******************************************************************************************** */
+std::vector <uint32_t> TriangleMesh::reorderMorton() {
+	const size_t n = vertices.size();
+	std::vector <uint32_t> new_index(n);
+	if(n == 0) return new_index;
+
+	// The code of each vertex, 10 bits per axis of the bounding box
+	Vec3 lo = vertices[0], hi = vertices[0];
+	for(size_t i = 1; i < n; i++) {
+		for(int k = 0; k < 3; k++) {
+			lo.f[k] = std::min(lo.f[k], vertices[i].f[k]);
+			hi.f[k] = std::max(hi.f[k], vertices[i].f[k]);
+		}
+	}
+	std::vector <std::pair <uint32_t, uint32_t> > codes(n);
+	for(size_t i = 0; i < n; i++) {
+		uint32_t code = 0;
+		for(int k = 0; k < 3; k++) {
+			float extent = hi.f[k] - lo.f[k];
+			uint32_t cell = (extent > 0.0f) ? (uint32_t) std::min(1023.0f, 1024.0f * (vertices[i].f[k] - lo.f[k]) / extent) : 0;
+			code |= spreadBits(cell) << k;
+		}
+		codes[i] = std::make_pair(code, (uint32_t) i);
+	}
+	std::sort(codes.begin(), codes.end());
+
+	std::vector <Vec3> new_vertices(n);
+	for(uint32_t i = 0; i < n; i++) {
+		new_index[codes[i].second] = i;
+		new_vertices[i] = vertices[codes[i].second];
+	}
+	vertices.swap(new_vertices);
+
+	// The triangles follow their first vertex, keeping their winding
+	std::vector <std::pair <uint32_t, size_t> > order(numTriangles());
+	for(size_t t = 0; t < numTriangles(); t++) {
+		for(int c = 0; c < 3; c++)
+			triangles[3 * t + c] = new_index[triangles[3 * t + c]];
+		order[t] = std::make_pair(std::min(triangles[3 * t], std::min(triangles[3 * t + 1], triangles[3 * t + 2])), t);
+	}
+	std::sort(order.begin(), order.end());
+	std::vector <uint32_t> new_triangles(triangles.size());
+	for(size_t t = 0; t < order.size(); t++)
+		std::copy(triangles.begin() + 3 * order[t].second, triangles.begin() + 3 * order[t].second + 3, new_triangles.begin() + 3 * t);
+	triangles.swap(new_triangles);
+	return new_index;
+}
+
+/* ******************************************************************************************** */
+/* The edges of the triangles, each with the corners opposite to it (the second one is -1 on the boundary) */
+static std::map <std::pair <uint32_t, uint32_t>, std::pair <int64_t, int64_t> > findEdges(
+		const std::vector <uint32_t> &triangles) {
+	std::map <std::pair <uint32_t, uint32_t>, std::pair <int64_t, int64_t> > edges;
+	for(size_t t = 0; t + 2 < triangles.size(); t += 3) {
+		for(int c = 0; c < 3; c++) {
+			uint32_t a = triangles[t + c], b = triangles[t + (c + 1) % 3], opposite = triangles[t + (c + 2) % 3];
+			std::pair <uint32_t, uint32_t> edge(std::min(a, b), std::max(a, b));
+			std::map <std::pair <uint32_t, uint32_t>, std::pair <int64_t, int64_t> >::iterator it = edges.find(edge);
+			if(it == edges.end()) edges[edge] = std::make_pair((int64_t) opposite, (int64_t) -1);
+			else if(it->second.second < 0) it->second.second = opposite;
+		}
+	}
+	return edges;
+}
+
+/* ******************************************************************************************** */
+std::vector <uint32_t> TriangleMesh::boundaryVertices() const {
+	std::vector <uint32_t> boundary;
+	std::map <std::pair <uint32_t, uint32_t>, std::pair <int64_t, int64_t> > edges = findEdges(triangles);
+	for(std::map <std::pair <uint32_t, uint32_t>, std::pair <int64_t, int64_t> >::const_iterator it = edges.begin();
+			it != edges.end(); it++) {
+		if(it->second.second >= 0) continue;
+		boundary.push_back(it->first.first);
+		boundary.push_back(it->first.second);
+	}
+	std::sort(boundary.begin(), boundary.end());
+	boundary.erase(std::unique(boundary.begin(), boundary.end()), boundary.end());
+	return boundary;
+}
+
+/* ******************************************************************************************** */
+void TriangleMesh::buildConstraints(Constraints &constraints) const {
+	std::vector <ConstraintPair> pairs;
+	std::map <std::pair <uint32_t, uint32_t>, std::pair <int64_t, int64_t> > edges = findEdges(triangles);
+	for(std::map <std::pair <uint32_t, uint32_t>, std::pair <int64_t, int64_t> >::const_iterator it = edges.begin();
+			it != edges.end(); it++) {
+		ConstraintPair stretch = {it->first.first, it->first.second};
+		pairs.push_back(stretch);
+		if(it->second.second < 0 || it->second.first == it->second.second) continue;
+		uint32_t a = it->second.first, b = it->second.second;
+		ConstraintPair bend = {std::min(a, b), std::max(a, b)};
+		pairs.push_back(bend);
+	}
+
+	// Two interior edges of a strip of triangles can have the same opposite corners
+	std::sort(pairs.begin(), pairs.end(), [](const ConstraintPair &a, const ConstraintPair &b) {
+		return a.p1 < b.p1 || (a.p1 == b.p1 && a.p2 < b.p2);
+	});
+	pairs.erase(std::unique(pairs.begin(), pairs.end(), [](const ConstraintPair &a, const ConstraintPair &b) {
+		return a.p1 == b.p1 && a.p2 == b.p2;
+	}), pairs.end());
+
+	// A pair of one vertex, or of two vertices at the same place, has no direction to project along
+	constraints = Constraints();
+	for(size_t c = 0; c < pairs.size(); c++) {
+		float rest_distance = (vertices[pairs[c].p1] - vertices[pairs[c].p2]).length();
+		if(pairs[c].p1 == pairs[c].p2 || rest_distance == 0.0f) continue;
+		constraints.pairs.push_back(pairs[c]);
+		constraints.rest_distance.push_back(rest_distance);
+	}
+	constraints.buildBatches();
+}
@@ -0,0 +1,48 @@
+/**
+ * @file TriangleMesh.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief Triangle meshes read from OBJ and PLY files, to build cloths that are not rectangular grids
+ */
+
+#pragma once
+
+#include "Constraint.h"
+
+#include <stdint.h>
+#include <vector>
+
+/* The vertices and triangles of a patch of cloth */
+class TriangleMesh {
+public:
+	std::vector <Vec3> vertices;
+	std::vector <uint32_t> triangles;  // three vertices per triangle, counter-clockwise seen from the front
+
+	size_t numTriangles() const { return triangles.size() / 3; }
+
+	/* Reads the v and f lines of an OBJ file: the texture and normal indices of the faces are ignored, negative
+	 indices count from the last vertex and faces with more than three corners are split into a fan. Returns false if
+	 the file cannot be read or a face is out of range. */
+	bool loadOBJ(const char *path);
+
+	/* Reads an ascii or binary_little_endian PLY file with float or double x, y and z vertex properties and a face
+	 list of vertex indices (vertex_indices or vertex_index), split into fans as for OBJ. Other elements and
+	 properties are skipped. */
+	bool loadPLY(const char *path);
+
+	/* loadOBJ() or loadPLY(), by the extension of the file */
+	bool load(const char *path);
+
+	/* Renumbers the vertices along a Morton (Z-order) curve through their bounding box, so that the vertices that are
+	 close on the surface are also close in memory, and sorts the triangles by their vertices. Returns the new index of
+	 each old vertex. */
+	std::vector <uint32_t> reorderMorton();
+
+	/* The vertices on an edge that has only one triangle, in order */
+	std::vector <uint32_t> boundaryVertices() const;
+
+	/* Stretch constraints along the edges of the triangles and bending constraints across the interior edges, between
+	 the corners opposite to the edge in its two triangles, at the distances of the vertices, leaving out the pairs at
+	 distance 0. They are sorted by their particles, so that they walk the particles in memory order, and batched. */
+	void buildConstraints(Constraints &constraints) const;
+};
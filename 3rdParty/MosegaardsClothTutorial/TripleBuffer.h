@@ -0,0 +1,45 @@
+/**
+ * @file TripleBuffer.h
+ * @author Can Erdogan
+ * @date Aug 14, 2012
+ * @brief Lock-free handoff of the latest state from one writer thread to one reader thread
+ */
+
+#pragma once
+
+#include <atomic>
+
+/* Three copies of a state: the writer fills the back one and publishes it by swapping it with the middle one, the
+ reader swaps the middle one with its front one if something new was published. Neither thread ever waits for the
+ other, the writer can publish faster than the reader reads (the states in between are dropped) and the reader keeps
+ the state it has until a newer one comes. Only one thread may write and only one may read. */
+template <class T>
+class TripleBuffer {
+private:
+	enum { FRESH = 4 };  // set in middle if it was published after the last update()
+
+	T buffers[3];
+	std::atomic <int> middle;  // the index of the buffer between the threads, | FRESH
+	int back;  // the writer's buffer
+	int front;  // the reader's buffer
+
+public:
+
+	TripleBuffer() : middle(1), back(0), front(2) {}
+
+	/* The buffer the writer fills, it keeps its contents from when it was last published or read */
+	T& writeBuffer() { return buffers[back]; }
+
+	/* Hands the write buffer over to the reader and gets another one */
+	void publish() { back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & 3; }
+
+	/* Takes the last published buffer if there is one, returns whether readBuffer() changed */
+	bool update() {
+		if(!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+		front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+		return true;
+	}
+
+	/* The buffer the reader got in the last update() */
+	const T& readBuffer() const { return buffers[front]; }
+};
@@ -23,12 +23,12 @@ public:
 
 	Vec3() {}
 
-	float length()
+	float length() const
 	{
 		return sqrt(f[0]*f[0]+f[1]*f[1]+f[2]*f[2]);
 	}
 
-	Vec3 normalized()
+	Vec3 normalized() const
 	{
 		float l = length();
 		return Vec3(f[0]/l,f[1]/l,f[2]/l);
@@ -41,37 +41,37 @@ public:
 		f[2]+=v.f[2];
 	}
 
-	Vec3 operator/ (const float &a)
+	Vec3 operator/ (const float &a) const
 	{
 		return Vec3(f[0]/a,f[1]/a,f[2]/a);
 	}
 
-	Vec3 operator- (const Vec3 &v)
+	Vec3 operator- (const Vec3 &v) const
 	{
 		return Vec3(f[0]-v.f[0],f[1]-v.f[1],f[2]-v.f[2]);
 	}
 
-	Vec3 operator+ (const Vec3 &v)
+	Vec3 operator+ (const Vec3 &v) const
 	{
 		return Vec3(f[0]+v.f[0],f[1]+v.f[1],f[2]+v.f[2]);
 	}
 
-	Vec3 operator* (const float &a)
+	Vec3 operator* (const float &a) const
 	{
 		return Vec3(f[0]*a,f[1]*a,f[2]*a);
 	}
 
-	Vec3 operator-()
+	Vec3 operator-() const
 	{
 		return Vec3(-f[0],-f[1],-f[2]);
 	}
 
-	Vec3 cross(const Vec3 &v)
+	Vec3 cross(const Vec3 &v) const
 	{
 		return Vec3(f[1]*v.f[2] - f[2]*v.f[1], f[2]*v.f[0] - f[0]*v.f[2], f[0]*v.f[1] - f[1]*v.f[0]);
 	}
 
-	float dot(const Vec3 &v)
+	float dot(const Vec3 &v) const
 	{
 		return f[0]*v.f[0] + f[1]*v.f[1] + f[2]*v.f[2];
 	}